@@ -17,6 +17,13 @@ defaults=$(<<EOF
 -DK_BOUNDED_SAFETY_AUT_IMPL='k_bounded_safety_aut'
 -DSTATIC_ARRAY_MAX='300'
 -DSTATIC_MAX_BITSETS='8ul'
+-DSTATIC_ARRAY_TIERS='static_tiers::exact'
+-DAP_REDUCTION='false'
+-DMERGE_SCHEDULER='merge_schedulers::cheapest_pair'
+-DMERGE_REDUCTION='false'
+-DSTRAGGLER_FACTOR='4'
+-DCANCEL_GRACE='200'
+-DSYMBOLIC_SAFETY='4096'
 -DSIMD_IS_MAX='true'
 -DAUT_PREPROCESSOR='aut_preprocessors::surely_losing'
 -DBOOLEAN_STATES='boolean_states::forward_saturation'
@@ -58,10 +65,17 @@ confs=(
     [simdnomax]="-DSIMD_IS_MAX=false"
     [autpreproc_standard]="-DAUT_PREPROCESSOR=aut_preprocessors::standard"
     [autpreproc_nopreproc]="-DAUT_PREPROCESSOR=aut_preprocessors::no_preprocessing"
+    [autpreproc_simulation]="-DAUT_PREPROCESSOR='aut_preprocessors::simulation<>'"
+    [best_autpreproc_simulation]="$best -DAUT_PREPROCESSOR='aut_preprocessors::simulation<aut_preprocessors::standard>'"
     [booleanstates_none]="-DBOOLEAN_STATES=boolean_states::no_boolean_states"
     [iosprecom_delegate]="-DIOS_PRECOMPUTER=ios_precomputers::delegate -DACTIONER='actioners::no_ios_precomputation<typename SetOfStates::value_type>'"
     [iosprecom_fake_vars]="-DIOS_PRECOMPUTER=ios_precomputers::fake_vars"
     [iosprecom_powset]="-DIOS_PRECOMPUTER=ios_precomputers::powset"
+    [ap_reduction]="-DAP_REDUCTION=true"
+    [merge_arrival]="-DMERGE_SCHEDULER=merge_schedulers::arrival"
+    [merge_reduction]="-DMERGE_REDUCTION=true"
+    [no_straggler_copies]="-DSTRAGGLER_FACTOR=0"
+    [no_symbolic_safety]="-DSYMBOLIC_SAFETY=0"
     [inputpicker_critical]="-DINPUT_PICKER=input_pickers::critical"
     [inputpicker_critical_pq]="-DINPUT_PICKER=input_pickers::critical_pq"
     [inputpicker_critical_rnd]="-DINPUT_PICKER=input_pickers::critical_rnd"
@@ -72,6 +86,9 @@ confs=(
     [downset_kdtree]="-DARRAY_AND_BITSET_DOWNSET_IMPL='kdtree_backed' -DVECTOR_AND_BITSET_DOWNSET_IMPL='kdtree_backed'"
     [best_downset_kdtree]="$best -DARRAY_AND_BITSET_DOWNSET_IMPL='kdtree_backed' -DVECTOR_AND_BITSET_DOWNSET_IMPL='kdtree_backed' -DNO_SIMD"
     [best_downset_kdtree_simd]="$best -DARRAY_AND_BITSET_DOWNSET_IMPL='kdtree_backed' -DVECTOR_AND_BITSET_DOWNSET_IMPL='kdtree_backed'"
+    [tiers_pow2]="-DSTATIC_ARRAY_TIERS=static_tiers::pow2"
+    [best_tiers_pow2]="$best -DSTATIC_ARRAY_TIERS=static_tiers::pow2"
+    [best_tiers_list]="$best -DSTATIC_ARRAY_TIERS='static_tiers::list<64,128,192,256>'"
     [downset_vector]="-DARRAY_AND_BITSET_DOWNSET_IMPL=vector_backed -DVECTOR_AND_BITSET_DOWNSET_IMPL=vector_backed"
     [best_downset_vector]="$best -DARRAY_AND_BITSET_DOWNSET_IMPL=vector_backed -DVECTOR_AND_BITSET_DOWNSET_IMPL=vector_backed -DNO_SIMD"
     [best_downset_vector_simd]="$best -DARRAY_AND_BITSET_DOWNSET_IMPL=vector_backed -DVECTOR_AND_BITSET_DOWNSET_IMPL=vector_backed"
@@ -192,8 +209,14 @@ if ! (( $donot[(Ie)compile] )); then
         fi
         cd $build
         echo -n "compiling $name (logfile: $log)... "
+        start=$SECONDS
         if meson compile &>> ../$log; then
-            echo "done"
+            # Compile time and binary size, to weigh against the runtime of
+            # configurations that reduce template instantiations.
+            secs=$(( SECONDS - start ))
+            size=$(stat -c %s src/acacia-bonsai)
+            echo "done in ${secs}s, binary is $size bytes"
+            echo "$name $secs $size" >> ../_bm-logs/compile-stats.txt
             touch compiled
         else
             echo "FAILED."
@@ -5,8 +5,11 @@
 #include <unordered_map>
 #include <vector>
 #include <algorithm>
+#include <chrono>
+#include <deque>
 
 #include <signal.h>
+#include <sys/prctl.h>
 #include <sys/wait.h>
 
 #include <boost/algorithm/string.hpp>
@@ -22,6 +25,7 @@
 
 #include <utils/verbose.hh>
 #include <utils/cache.hh>
+#include <utils/trace.hh>
 
 #include "configuration.hh"
 #include "composition/composition_mt.hh"
@@ -70,6 +74,14 @@ static std::string synth_fname;
 static std::string winreg_fname;
 static std::vector<int> init_state;
 static int workers = 0;
+static bool opt_decompose = false;
+static size_t opt_mem_budget = 0;
+static std::string opt_listen;
+static int opt_remote_workers = 0;
+static std::string opt_trace;
+static bool opt_warm_pool = false;
+static int opt_max_procs = 0;
+static double opt_time_slice = 1;
 
 
 enum {
@@ -91,15 +103,28 @@ utils::voutstream utils::vout;
 size_t posets::vectors::bool_threshold = 0;
 size_t posets::vectors::bitset_threshold = 0;
 
+// with --max-procs, each check runs in its own process group, so that it is
+// stopped along with its workers
+static pid_t main_pid = -1;
+static std::vector<pid_t> check_groups;
+
 void terminate (int signum) {
-  if (getpgid (0) == getpid ()) { // Main process
+  if (getpid () == main_pid) { // Main process
     signal (SIGTERM, SIG_IGN);
     kill (0, SIGTERM);
+    // a stopped check only gets the signal once continued
+    for (auto pgid : check_groups) {
+      kill (-pgid, SIGTERM);
+      kill (-pgid, SIGCONT);
+    }
     while (wait (NULL) != -1)
       /* no body */;
   }
-  else
+  else {
+    // _exit skips the atexit handlers
+    shm_segments::cleanup ();
     _exit (3);
+  }
 }
 
 
@@ -125,6 +150,34 @@ void process_args_(const ArgParseResult& arg_vals) {
   opt_Kmin = arg_vals.opt_Kstart;
   opt_Kinc = arg_vals.opt_Kinc;
   utils::verbose = arg_vals.verbose_level;
+  opt_decompose = arg_vals.decompose;
+  workers = arg_vals.workers;
+
+  // values are case insensitive, as in "-c BOTH"
+  auto check = boost::algorithm::to_lower_copy (arg_vals.check);
+  auto unreal_x = boost::algorithm::to_lower_copy (arg_vals.unreal_x);
+  if (check == "real")
+    opt_check = CHECK_REAL;
+  else if (check == "unreal")
+    opt_check = CHECK_UNREAL;
+  else if (check == "both")
+    opt_check = CHECK_BOTH;
+  else
+    error (3, 0, "unknown value for --check: %s", arg_vals.check.c_str ());
+
+  if (unreal_x == "formula")
+    opt_unreal_x = UNREAL_X_FORMULA;
+  else if (unreal_x == "automaton")
+    opt_unreal_x = UNREAL_X_AUTOMATON;
+  else if (not unreal_x.empty ())
+    error (3, 0, "unknown value for --unreal-x: %s", arg_vals.unreal_x.c_str ());
+  opt_mem_budget = arg_vals.mem_budget;
+  opt_listen = arg_vals.listen_addr;
+  opt_remote_workers = arg_vals.remote_workers;
+  opt_trace = arg_vals.trace_fname;
+  opt_warm_pool = arg_vals.warm_pool;
+  opt_max_procs = arg_vals.max_procs;
+  opt_time_slice = arg_vals.time_slice;
 
   if (not arg_vals.extra_opts.empty()) {
     extra_options.parse_options (arg_vals.extra_opts.c_str());
@@ -191,6 +244,16 @@ int main (int argc, char **argv) {
 
     process_args_(arg_values);
 
+    if (not opt_trace.empty ())
+      utils::trace::open (opt_trace);
+
+    // a remote worker only serves the jobs of its coordinator
+    if (not arg_values.worker_addr.empty ()) {
+      spot::bdd_dict_ptr dict = spot::make_bdd_dict ();
+      spot::translator trans (dict, &extra_options);
+      return composition_mt::remote_worker (arg_values.worker_addr, dict, trans, opt_warm_pool);
+    }
+
     check_no_formula ();
 
     // Adjust the value of K
@@ -207,33 +270,53 @@ int main (int argc, char **argv) {
     spot::bdd_dict_ptr dict = spot::make_bdd_dict ();
     spot::translator trans (dict, &extra_options);
     ltl_processor processor (trans, input_aps, output_aps, dict, synth_fname, winreg_fname, check_real,
-      opt_unreal_x, workers, opt_K, opt_Kmin, opt_Kinc, init_state);
+      opt_unreal_x, workers, opt_K, opt_Kmin, opt_Kinc, init_state, opt_decompose,
+      opt_mem_budget, opt_listen, opt_remote_workers, opt_warm_pool, opt_max_procs > 0);
 
     // Diagnose unused -x options
     extra_options.report_unused_options ();
 
 
 
+    // only the first check listens for the remote workers
+    bool first_proc = true;
     const auto start_proc = [&] (bool real, unreal_x_t unreal_x) {
-      if (fork () == 0) {
-        utils::vout.set_prefix (std::string {"["}
-                                + (real ?
-                                   "real" :
-                                   std::string {"unreal-x="} + (char) unreal_x)
-                                + "] ");
+      pid_t pid = fork ();
+      if (pid == 0) {
+        if (opt_max_procs > 0) {
+          setpgid (0, 0);
+          // out of the group of main, the check would outlive it; it is
+          // killed rather than terminated, as it may be stopped
+          prctl (PR_SET_PDEATHSIG, SIGKILL);
+          if (getppid () != main_pid)
+            _exit (3);
+        }
+        if (not first_proc)
+          processor.drop_remote_workers ();
+        auto name = real ? std::string {"real"} : std::string {"unreal-x="} + (char) unreal_x;
+        utils::vout.set_prefix ("[" + name + "] ");
+        utils::trace::set_process (name);
         check_real = real;
         if (!real) {
           synth_fname = ""; // no synthesis for the environment if the formula is unrealizable
         }
         opt_unreal_x = unreal_x;
+        processor.set_check (real, unreal_x);
         int res = processor.run ();
         verb_do (1, vout << "returning " << (res ? 1 - real : 3) << "\n");
         exit (res ? 1 - real : 3);  // 0 if real, 1 if unreal, 3 if unknown
       }
+      if (opt_max_procs > 0) {
+        // both sides set the group, so that it exists before it is stopped
+        setpgid (pid, pid);
+        check_groups.push_back (pid);
+      }
+      first_proc = false;
     };
 
     setpgid (0, 0);
     assert (getpgid (0) == getpid ());
+    main_pid = getpid ();
     if (opt_check == CHECK_BOTH or opt_check == CHECK_REAL)
       start_proc (true, UNREAL_X_BOTH);
     if (opt_check == CHECK_BOTH or opt_check == CHECK_UNREAL) {
@@ -243,8 +326,55 @@ int main (int argc, char **argv) {
         start_proc (false, UNREAL_X_AUTOMATON);
     }
 
+    // Only the first opt_max_procs checks of turns run, the others are
+    // stopped.  The checks are started in the order in which they usually
+    // answer first, as nothing cheaper than their translation tells them
+    // apart; every time slice, the check that has run the longest gives its
+    // turn to the next one.
+    std::deque<pid_t> turns (check_groups.begin (), check_groups.end ());
+    const auto give_turns = [&] {
+      for (size_t i = 0; i < turns.size (); ++i)
+        kill (-turns[i], (int) i < opt_max_procs ? SIGCONT : SIGSTOP);
+    };
+    give_turns ();
+    auto slice = std::chrono::duration<double> (opt_time_slice);
+    auto slice_end = std::chrono::steady_clock::now () + slice;
+
+    // SIGCHLD stays pending while blocked, so that a check ending between
+    // waitpid and sigtimedwait still wakes the latter up; the checks are
+    // already started and do not inherit the mask
+    sigset_t sigchld;
+    sigemptyset (&sigchld);
+    sigaddset (&sigchld, SIGCHLD);
+    sigprocmask (SIG_BLOCK, &sigchld, nullptr);
+
     int ret;
-    while (wait (&ret) != -1) { // as long as we have children to wait for
+    pid_t pid;
+    while (true) {
+      if (turns.size () > (size_t) opt_max_procs) {
+        pid = waitpid (-1, &ret, WNOHANG);
+        if (pid == 0) {
+          auto left = slice_end - std::chrono::steady_clock::now ();
+          if (left <= decltype (left)::zero ()) {
+            verb_do (1, vout << "Check " << turns.front () << " gives its turn\n");
+            turns.push_back (turns.front ());
+            turns.pop_front ();
+            give_turns ();
+            slice_end = std::chrono::steady_clock::now () + slice;
+            continue;
+          }
+          // sleep until a check changes state or the slice ends
+          auto ns = std::chrono::duration_cast<std::chrono::nanoseconds> (left).count ();
+          timespec timeout {time_t (ns / 1'000'000'000), long (ns % 1'000'000'000)};
+          sigtimedwait (&sigchld, nullptr, &timeout);
+          continue;
+        }
+      }
+      else
+        pid = wait (&ret);
+      if (pid == -1) // no more children to wait for
+        break;
+
       if (not WIFEXITED (ret)) {
         std::cout << "ERROR: A child died unexepectedly";
         if (WIFSIGNALED (ret))
@@ -263,6 +393,14 @@ int main (int argc, char **argv) {
           std::cout << "UNREALIZABLE\n";
         return ret;
       }
+
+      // the check did not conclude, the next one takes its turn
+      auto it = std::find (turns.begin (), turns.end (), pid);
+      if (it != turns.end ()) {
+        turns.erase (it);
+        give_turns ();
+        slice_end = std::chrono::steady_clock::now () + slice;
+      }
     }
     std::cout << "UNKNOWN\n";
     return 3;
@@ -2,6 +2,9 @@
 
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <fstream>
+#include <tuple>
 #include "utils/typeinfo.hh"
 
 class aiger {
@@ -64,6 +67,79 @@ class aiger {
     outputs[i] = bdd2aig (func);
   }
 
+  // Parallel composition of circuits with the same inputs and outputs, such
+  // as the controllers of the clusters of a specification: the latches of
+  // the parts are put side by side, and output i is taken from the part
+  // owner[i], or is constant 0 if owner[i] is -1.
+  static aiger parallel (const std::vector<aiger>& parts, const std::vector<int>& owner) {
+    assert (not parts.empty ());
+    aiger res;
+    res.inputs = parts[0].inputs;
+    res.input_names = parts[0].input_names;
+    res.output_names = parts[0].output_names;
+    res.outputs.assign (parts[0].outputs.size (), 0);
+    assert (owner.size () == res.outputs.size ());
+
+    size_t nlatches = 0;
+    for (const auto& part : parts)
+      nlatches += part.latches.size ();
+    res.latches.assign (nlatches, -1); // no BDD variable stands for them
+    res.latches_id.assign (nlatches, 0);
+    res.vi = 2 + 2 * res.inputs.size () + 2 * nlatches;
+
+    size_t first_latch = 0;
+    for (size_t k = 0; k < parts.size (); ++k) {
+      const aiger& part = parts[k];
+      assert (part.inputs == res.inputs);
+      int first_part_latch = 2 + 2 * part.inputs.size ();
+      int first_gate = first_part_latch + 2 * part.latches.size ();
+      std::map<int, int> renamed; // gate of the part -> literal in res
+
+      auto literal = [&] (int lit) {
+        int var = lit & ~1;
+        if (var < first_part_latch)
+          return lit; // constant or input
+        if (var < first_gate)
+          return lit + 2 * (int) first_latch;
+        return renamed.at (var) ^ (lit & 1);
+      };
+
+      // a gate is numbered after the gates it reads
+      std::vector<std::tuple<int, int, int>> gates;
+      for (const auto& [in, out] : part.gates)
+        gates.emplace_back (out, in.first, in.second);
+      std::sort (gates.begin (), gates.end ());
+      auto ready = [&] (int lit) {
+        int var = lit & ~1;
+        return var < first_gate or renamed.contains (var);
+      };
+      for (const auto& [out, i1, i2] : gates) {
+        assert (ready (i1) and ready (i2));
+        renamed[out] = res.add_gate (literal (i1), literal (i2));
+      }
+
+      for (size_t i = 0; i < part.latches.size (); ++i)
+        res.latches_id[first_latch + i] = literal (part.latches_id[i]);
+      for (size_t i = 0; i < owner.size (); ++i)
+        if (owner[i] == (int) k)
+          res.outputs[i] = literal (part.outputs[i]);
+      first_latch += part.latches.size ();
+    }
+    return res;
+  }
+
+  // write the circuit to fname, or to the verbose output if fname is "-"
+  void save (const std::string& fname) {
+    if (fname != "-") {
+      std::ofstream f (fname);
+      output (f, false);
+      f.close ();
+    } else {
+      utils::vout << "\n\n\n";
+      output (utils::vout, true);
+    }
+  }
+
   // output, info prints some stuff (that is not allowed in the ascii format)
   void output (std::ostream& ost, bool info) {
     ost << "aag " << ((vi - 2) / 2) << " " << inputs.size () << " " << latches.size () << " ";
@@ -109,6 +185,8 @@ class aiger {
   }
 
   private:
+  aiger () = default;
+
   std::vector<int> inputs, latches; // index i gives bdd_var(b) of i-th input or i-th state AP
   int vi; // free variable index
 
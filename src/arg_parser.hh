@@ -21,6 +21,18 @@ struct ArgParseResult {
 
 
   bool moore_mode = false;
+  bool decompose = false;
+  int workers = 0;
+  size_t mem_budget = 0;
+  std::string check = "real";
+  std::string worker_addr = "";
+  std::string listen_addr = "";
+  int remote_workers = 0;
+  bool warm_pool = false;
+  std::string trace_fname = "";
+  std::string unreal_x = "";
+  int max_procs = 0;
+  double time_slice = 1;
   std::vector<int> init_state = {};
   std::vector<std::string> inputs = {};
   std::vector<std::string> outputs = {};
@@ -70,11 +82,29 @@ inline ArgParseResult arg_parser(int argc, char **argv) {
     ("init,0", po::value<std::string>()->value_name("STATE"),
       "comma-separated state vector to use as initial state")
 
-    ("inputs,i", po::value<std::string>()->required()->value_name("PROPS"),
+    ("inputs,i", po::value<std::string>()->value_name("PROPS"),
       "comma-separated list of uncontrollable (a.k.a. input) atomic propositions")
-    // ("workers,j", po::value<std::string>()->value_name("VAL"),
-    //   "Number of parallel workers for composition")
-    ("outputs,o", po::value<std::string>()->required()->value_name("PROPS"),
+    ("workers,j", po::value<int>()->value_name("VAL"),
+      "number of parallel workers for composition, default is one per core")
+    ("mem-budget", po::value<size_t>()->value_name("MB"),
+      "memory budget for the composition workers, jobs that would exceed it "
+                             "are held back")
+    ("listen", po::value<std::string>()->value_name("ADDR"),
+      "address on which remote composition workers connect, either "
+                             "HOST:PORT or unix:PATH")
+    ("remote-workers", po::value<int>()->value_name("N"),
+      "number of remote workers to wait for on the --listen address")
+    ("worker", po::value<std::string>()->value_name("ADDR"),
+      "run as a remote composition worker for the coordinator listening on "
+                             "ADDR; no formula, inputs nor outputs are needed")
+    ("warm-pool", po::bool_switch()->default_value(false),
+      "warm up Spot and BuDDy once before forking the composition workers, "
+                             "which then inherit it; a remote worker warms up "
+                             "before its first job")
+    ("trace", po::value<std::string>()->value_name("FILENAME"),
+      "write a timeline of the composition jobs in the Chrome trace format, "
+                             "for chrome://tracing or ui.perfetto.dev")
+    ("outputs,o", po::value<std::string>()->value_name("PROPS"),
       "comma-separated list of controllable (a.k.a. output) atomic propositions")
 
     ("synth,S", po::value<std::string>()->value_name("FILENAME"),
@@ -91,17 +121,27 @@ inline ArgParseResult arg_parser(int argc, char **argv) {
       "starting value of K; Kinc MUST be set when using "
                              "this option")
 
-    // ("unreal-x,u", po::value<std::string>()->value_name("[formula|automaton]"),
-    //   "for unrealizability, either add X's to outputs in "
-    //                          "the input formula, or push outputs one transition "
-    //                          "forward in the automaton.")
+    ("unreal-x,u", po::value<std::string>()->value_name("[formula|automaton]"),
+      "for unrealizability, either add X's to outputs in "
+                             "the input formula, or push outputs one transition "
+                             "forward in the automaton.")
 
     ("moore", po::bool_switch()->default_value(false),
       "synthesise a Moore machine, if not specified a mealy machine will be symthesised.")
+    ("decompose", po::bool_switch()->default_value(false),
+      "split the formula into conjuncts, such as A -> g for each guarantee g "
+                             "of A -> (g1 & g2 & ...), and solve them by composition")
 
     // output options
-    // ("check,c", po::value<std::string>()->value_name("[real|unreal|both]"),
-    //   "either check for real, unreal, or both")
+    ("check,c", po::value<std::string>()->value_name("[real|unreal|both]"),
+      "either check for real, unreal, or both")
+    ("max-procs", po::value<int>()->value_name("N"),
+      "run at most N of the checks at a time, the others being stopped and "
+                             "taking turns, in the order real, formula, "
+                             "automaton; default is all of them")
+    ("time-slice", po::value<double>()->value_name("SECONDS"),
+      "how long a check runs before it gives its turn, with --max-procs; "
+                             "default is 1")
     // NOTE: this weird construction such that "verbose" can be specified multiple times
     // ("verbose,v", po::value<std::vector<bool>>()
     //   ->default_value(std::vector<bool>(), "false")
@@ -155,6 +195,23 @@ inline ArgParseResult arg_parser(int argc, char **argv) {
       process_arg_init_(vm["init"].as<std::string>(), retval);
     }
 
+    if (vm.contains("trace")) {
+      retval.trace_fname = vm["trace"].as<std::string>();
+    }
+
+    retval.warm_pool = vm["warm-pool"].as<bool>();
+
+    // a worker gets everything from its coordinator
+    if (vm.contains("worker")) {
+      retval.worker_addr = vm["worker"].as<std::string>();
+      retval.verbose_level += vm["verbose"].as<int>();
+      return retval;
+    }
+
+    if (not vm.contains("inputs") or not vm.contains("outputs")) {
+      error(3, 0, "Error: the options 'inputs' and 'outputs' are required.");
+    }
+
     process_arg_input_(vm["inputs"].as<std::string>(), retval);
     process_arg_output_(vm["outputs"].as<std::string>(), retval);
 
@@ -179,13 +236,56 @@ inline ArgParseResult arg_parser(int argc, char **argv) {
       retval.moore_mode = true;
     }
 
+    retval.decompose = vm["decompose"].as<bool>();
+
+    if (vm.contains("workers")) {
+      retval.workers = vm["workers"].as<int>();
+    }
+
+    if (vm.contains("mem-budget")) {
+      retval.mem_budget = vm["mem-budget"].as<size_t>();
+    }
+
+    if (vm.contains("remote-workers")) {
+      if (not vm.contains("listen")) {
+        error(3, 0, "Error: if 'remote-workers' is specified, then 'listen' also must be provided.");
+      }
+      retval.remote_workers = vm["remote-workers"].as<int>();
+      retval.listen_addr = vm["listen"].as<std::string>();
+    }
+
+    if (vm.contains("check")) {
+      retval.check = vm["check"].as<std::string>();
+    }
+
+    if (vm.contains("unreal-x")) {
+      retval.unreal_x = vm["unreal-x"].as<std::string>();
+    }
+
+    if (vm.contains("max-procs")) {
+      retval.max_procs = vm["max-procs"].as<int>();
+      if (retval.max_procs < 1) {
+        error(3, 0, "Error: 'max-procs' must be at least 1.");
+      }
+    }
+
+    if (vm.contains("time-slice")) {
+      if (not vm.contains("max-procs")) {
+        error(3, 0, "Error: if 'time-slice' is specified, then 'max-procs' also must be provided.");
+      }
+      retval.time_slice = vm["time-slice"].as<double>();
+      if (retval.time_slice <= 0) {
+        error(3, 0, "Error: 'time-slice' must be positive.");
+      }
+    }
+
     retval.verbose_level += vm["verbose"].as<int>();
 
     if (vm.count("extra_opts")) {
       retval.extra_opts = vm["extra_opts"].as<std::string>();
     }
 
-    // TODO: handle removed arguments: workers, opt_unreal, check, winreg
+    // TODO: handle removed arguments: winreg
 
     debug_("[DEBUG] Finished parsing arguments.");
 
@@ -3,5 +3,6 @@
 #include "configuration.hh"
 
 #include "aut_preprocessors/no_preprocessing.hh"
+#include "aut_preprocessors/simulation.hh"
 #include "aut_preprocessors/standard.hh"
 #include "aut_preprocessors/surely_losing.hh"
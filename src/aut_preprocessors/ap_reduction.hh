@@ -0,0 +1,101 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include <spot/twa/twagraph.hh>
+
+#include <utils/verbose.hh>
+
+
+namespace aut_preprocessors {
+  // The letters that need to be enumerated to build the actions of an
+  // automaton.  The supports only keep the APs that appear on some edge or
+  // in the invariant; the restrictions only keep one valuation per orbit of
+  // the AP permutations that leave the edges and the invariant unchanged.
+  struct ap_reduction_t {
+      bdd input_support, output_support;
+      bdd input_restriction, output_restriction;
+  };
+
+  namespace detail {
+    inline std::vector<int> support_vars (bdd support) {
+      std::vector<int> vars;
+      for (; support != bddtrue; support = bdd_high (support))
+        vars.push_back (bdd_var (support));
+      return vars;
+    }
+
+    template <typename Aut>
+    bool swap_is_symmetry (const Aut& aut, bdd invariant, int a, int b) {
+      bddPair* swap = bdd_newpair ();
+      bdd_setbddpair (swap, a, bdd_ithvar (b));
+      bdd_setbddpair (swap, b, bdd_ithvar (a));
+      bool symmetric = (bdd_veccompose (invariant, swap) == invariant);
+      for (size_t q = 0; symmetric and q < aut->num_states (); ++q)
+        for (auto& e : aut->out (q))
+          if (bdd_veccompose (e.cond, swap) != e.cond) {
+            symmetric = false;
+            break;
+          }
+      bdd_freepair (swap);
+      return symmetric;
+    }
+
+    // Returns the used variables of support, and the constraint that orders
+    // the valuations within each class of interchangeable variables.  If
+    // (a b) and (a c) are symmetries, then so is any permutation of {a, b,
+    // c}, so a variable only needs to be tested against the first variable of
+    // each class.
+    template <typename Aut>
+    std::pair<bdd, bdd> reduce_support (const Aut& aut, bdd invariant,
+                                        bdd support, const std::vector<int>& used) {
+      bdd reduced = bddtrue;
+      std::vector<std::vector<int>> classes;
+
+      for (auto v : support_vars (support)) {
+        if (not std::binary_search (used.begin (), used.end (), v))
+          continue;
+        reduced &= bdd_ithvar (v);
+        auto cl = std::find_if (classes.begin (), classes.end (),
+                                [&] (const auto& c) {
+                                  return swap_is_symmetry (aut, invariant, c.front (), v);
+                                });
+        if (cl == classes.end ())
+          classes.push_back ({v});
+        else
+          cl->push_back (v);
+      }
+
+      bdd restriction = bddtrue;
+      for (const auto& cl : classes)
+        for (size_t i = 1; i < cl.size (); ++i)
+          restriction &= bdd_imp (bdd_ithvar (cl[i]), bdd_ithvar (cl[i - 1]));
+      return {reduced, restriction};
+    }
+  }
+
+  template <typename Aut>
+  ap_reduction_t ap_reduction (const Aut& aut, bdd invariant,
+                               bdd input_support, bdd output_support) {
+    bdd used = bdd_support (invariant);
+    for (size_t q = 0; q < aut->num_states (); ++q)
+      for (auto& e : aut->out (q))
+        used &= bdd_support (e.cond);
+    auto used_vars = detail::support_vars (used);
+    std::sort (used_vars.begin (), used_vars.end ());
+
+    auto [ins, in_restriction] = detail::reduce_support (aut, invariant, input_support, used_vars);
+    auto [outs, out_restriction] = detail::reduce_support (aut, invariant, output_support, used_vars);
+
+    verb_do (1, vout << "AP reduction: " << detail::support_vars (input_support).size ()
+             /*   */ << " -> " << detail::support_vars (ins).size () << " inputs, "
+             /*   */ << detail::support_vars (output_support).size ()
+             /*   */ << " -> " << detail::support_vars (outs).size () << " outputs, "
+             /*   */ << bdd_satcountset (in_restriction, ins) << " input and "
+             /*   */ << bdd_satcountset (out_restriction, outs) << " output letters."
+             /*   */ << std::endl);
+
+    return {ins, outs, in_restriction, out_restriction};
+  }
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <vector>
+
+#include <spot/twaalgos/hoa.hh>
+
+#include <utils/verbose.hh>
+
+#include "aut_preprocessors/surely_losing.hh"
+
+
+namespace aut_preprocessors {
+  // Direct simulation on the automaton read as a Büchi automaton:
+  // sim[p][q] holds iff q simulates p, that is, p accepting implies q
+  // accepting, and every edge p -c-> p' can be matched, letter by letter, by
+  // edges q -c'-> q' with sim[p'][q'].  The UcB accepts the complement of the
+  // language of that Büchi automaton, so any reduction that preserves the
+  // latter is sound here.
+  template <typename Aut>
+  auto direct_simulation (const Aut& aut) {
+    const size_t n = aut->num_states ();
+    std::vector<std::vector<bool>> sim (n, std::vector<bool> (n));
+
+    for (size_t p = 0; p < n; ++p)
+      for (size_t q = 0; q < n; ++q)
+        sim[p][q] = not aut->state_is_accepting (p) or aut->state_is_accepting (q);
+
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (size_t p = 0; p < n; ++p)
+        for (size_t q = 0; q < n; ++q) {
+          if (p == q or not sim[p][q])
+            continue;
+          for (auto& e : aut->out (p)) {
+            bdd cover = bddfalse;
+            for (auto& f : aut->out (q))
+              if (sim[e.dst][f.dst])
+                cover |= f.cond;
+            if ((e.cond & !cover) != bddfalse) {
+              sim[p][q] = false;
+              changed = true;
+              break;
+            }
+          }
+        }
+    }
+    return sim;
+  }
+
+  // Quotients the automaton by simulation equivalence, then removes from
+  // every edge the letters on which a sibling edge goes to a strictly larger
+  // state (pruning of little brothers).  Returns the mapping from the
+  // original states to the new ones, with -1u for states that are gone.
+  template <typename Aut>
+  std::vector<unsigned> reduce_by_simulation (Aut& aut, bool prune = true) {
+    const size_t n = aut->num_states ();
+    auto sim = direct_simulation (aut);
+
+    std::vector<unsigned> rep (n);
+    for (size_t p = 0; p < n; ++p) {
+      rep[p] = p;
+      for (size_t q = 0; q < p; ++q)
+        if (sim[p][q] and sim[q][p]) {
+          rep[p] = rep[q];
+          break;
+        }
+    }
+
+    for (size_t s = 0; s < n; ++s)
+      for (auto& e : aut->out (s))
+        e.dst = rep[e.dst];
+    aut->set_init_state (rep[aut->get_init_state_number ()]);
+
+    if (prune)
+      for (size_t s = 0; s < n; ++s) {
+        if (rep[s] != s)
+          continue;
+        std::vector<std::pair<bdd, unsigned>> siblings;
+        for (auto& e : aut->out (s))
+          siblings.emplace_back (e.cond, e.dst);
+        for (auto e = aut->out_iteraser (s); e; ) {
+          bdd dominated = bddfalse;
+          for (auto& [cond, dst] : siblings)
+            if (dst != e->dst and sim[e->dst][dst])
+              dominated |= cond;
+          e->cond &= !dominated;
+          if (e->cond == bddfalse)
+            e.erase ();
+          else
+            ++e;
+        }
+      }
+
+    aut->prop_universal (spot::trival::maybe ());
+    aut->merge_edges ();
+
+    std::vector<unsigned> purged;
+    spot::twa_graph::shift_action keep = [] (const std::vector<unsigned>& v, void* data) {
+      *static_cast<std::vector<unsigned>*> (data) = v;
+    };
+    aut->purge_unreachable_states (&keep, &purged);
+
+    std::vector<unsigned> mapping (n);
+    for (size_t p = 0; p < n; ++p)
+      mapping[p] = purged.empty () ? rep[p] : purged[rep[p]];
+    return mapping;
+  }
+
+  namespace detail {
+    template <typename Aut, typename Before>
+    class simulation {
+      public:
+        simulation (Aut& aut, Before before) :
+          aut {aut}, before {before}
+        {}
+
+        auto operator() () {
+          before ();
+          auto states = aut->num_states ();
+          reduce_by_simulation (aut);
+          verb_do (1, vout << "Simulation reduced aut from " << states
+                   /*   */ << " to " << aut->num_states () << " states." << std::endl);
+          verb_do (2, {
+              vout << "Automaton after simulation reduction:\n";
+              spot::print_hoa(vout, aut, nullptr) << std::endl;
+            });
+        }
+
+      private:
+        Aut& aut;
+        Before before;
+    };
+  }
+
+  template <typename Before = surely_losing>
+  struct simulation {
+      template <typename Aut>
+      static auto make (Aut& aut, bdd input_support, bdd output_support, unsigned K) {
+        return detail::simulation (aut, Before::make (aut, input_support, output_support, K));
+      }
+  };
+}
@@ -1,5 +1,11 @@
 #pragma once
 
+#include <algorithm>
+#include <deque>
+#include <list>
+#include <map>
+#include <vector>
+
 #include <spot/twaalgos/hoa.hh>
 #include <spot/twaalgos/isdet.hh>
 #include <spot/twaalgos/mask.hh>
@@ -29,27 +35,48 @@ namespace aut_preprocessors {
           for (size_t q = 0; q < aut->num_states(); ++q)
             c[q] = (aut->state_is_accepting (q)) ? 1 : 0;
 
-          bool changed = true;
-          while (changed) {
-            changed = false;
-
-            for (size_t q = 0; q < aut->num_states(); ++q) {
-              if (c[q] > K) // Already losing.
-                continue;
-
-              // Compute max_i min_o c[q.<io>]
-              unsigned max = 0;
-              for (auto& transitions : isuccs[q]) {
-                unsigned min = K + 1;
-                for (auto& [cond, to] : transitions)
-                  min = std::min (min, c[to]);
-                max = std::max (max, min);
-              }
-              max += (aut->state_is_accepting (q)) ? 1 : 0;
-              if (c[q] != max) {
-                changed = true;
-                c[q] = max;
-              }
+          // preds[q] lists the states that have q in one of their isuccs: only
+          // these need to be reevaluated when c[q] changes.
+          std::vector<std::vector<unsigned>> preds (aut->num_states ());
+          for (size_t q = 0; q < aut->num_states (); ++q) {
+            for (auto& transitions : isuccs[q])
+              for (auto& [cond, to] : transitions)
+                preds[to].push_back (q);
+          }
+          for (auto& p : preds) {
+            std::sort (p.begin (), p.end ());
+            p.erase (std::unique (p.begin (), p.end ()), p.end ());
+          }
+
+          std::deque<unsigned> worklist;
+          std::vector<bool> in_worklist (aut->num_states (), true);
+          for (size_t q = 0; q < aut->num_states (); ++q)
+            worklist.push_back (q);
+
+          while (not worklist.empty ()) {
+            auto q = worklist.front ();
+            worklist.pop_front ();
+            in_worklist[q] = false;
+
+            if (c[q] > K) // Already losing.
+              continue;
+
+            // Compute max_i min_o c[q.<io>]
+            unsigned max = 0;
+            for (auto& transitions : isuccs[q]) {
+              unsigned min = K + 1;
+              for (auto& [cond, to] : transitions)
+                min = std::min (min, c[to]);
+              max = std::max (max, min);
+            }
+            max += (aut->state_is_accepting (q)) ? 1 : 0;
+            if (c[q] != max) {
+              c[q] = max;
+              for (auto p : preds[q])
+                if (not in_worklist[p]) {
+                  in_worklist[p] = true;
+                  worklist.push_back (p);
+                }
             }
           }
 
@@ -81,32 +108,70 @@ namespace aut_preprocessors {
       private:
         auto compute_isuccs () const {
           using trans_set_t = std::vector<std::pair<bdd, unsigned>>;
-          using crossings_t = std::list<std::pair<bdd, trans_set_t>>;
+          using index_set_t = std::vector<size_t>;
+          using crossings_t = std::list<std::pair<bdd, index_set_t>>;
 
           std::vector<std::list<trans_set_t>> isuccs (aut->num_states ());
 
+          // The input partition of a state only depends on the labels of its
+          // outgoing edges, so it is computed once per multiset of labels.
+          // It is stored as sets of indices in the sorted list of edges, and
+          // each state then plugs in its own destinations.
+          std::map<std::vector<int>, std::list<index_set_t>> partitions;
+
           for (size_t q = 0; q < aut->num_states (); ++q) {
-            auto input_power =
-              ios_precomputers::detail::power<crossings_t> (
-                transition_enumerator (aut, q, transition_formater::cond_and_dst (aut)),
-                [this] (bdd b) {
-                  return bdd_exist (b, output_support);
-                });
-            // We're not interested in inputs for which there's an output that
-            // makes us leave the game.
-            for (auto& [input, trans] : input_power) {
-              bdd all_outs = bddfalse;
-              for (auto& [cond, dst] : trans) {
-                auto input_and_cond_over_outs =
-                  bdd_exist (input & cond, input_support);
-                all_outs |= input_and_cond_over_outs;
-                if (all_outs == bddtrue)
-                  break;
+            trans_set_t edges;
+            for (auto& e : aut->out (q))
+              edges.emplace_back (e.cond, e.dst);
+            std::stable_sort (edges.begin (), edges.end (),
+                              [] (const auto& a, const auto& b) {
+                                return a.first.id () < b.first.id ();
+                              });
+
+            std::vector<int> signature;
+            for (auto& [cond, dst] : edges)
+              signature.push_back (cond.id ());
+
+            auto partition = partitions.find (signature);
+            if (partition == partitions.end ()) {
+              std::vector<std::pair<bdd, size_t>> labels;
+              for (size_t i = 0; i < edges.size (); ++i)
+                labels.emplace_back (edges[i].first, i);
+
+              auto input_power =
+                ios_precomputers::detail::power<crossings_t> (
+                  labels,
+                  [this] (bdd b) {
+                    return bdd_exist (b, output_support);
+                  });
+              // We're not interested in inputs for which there's an output that
+              // makes us leave the game.
+              std::list<index_set_t> kept;
+              for (auto& [input, indices] : input_power) {
+                bdd all_outs = bddfalse;
+                for (auto i : indices) {
+                  auto input_and_cond_over_outs =
+                    bdd_exist (input & edges[i].first, input_support);
+                  all_outs |= input_and_cond_over_outs;
+                  if (all_outs == bddtrue)
+                    break;
+                }
+                if (all_outs == bddtrue) // Keep this set of transitions
+                  kept.push_front (std::move (indices));
               }
-              if (all_outs == bddtrue) // Keep this set of transitions
-                isuccs[q].push_front (std::move (trans));
+              partition = partitions.emplace (std::move (signature), std::move (kept)).first;
+            }
+
+            for (auto& indices : partition->second) {
+              trans_set_t trans;
+              for (auto i : indices)
+                trans.push_back (edges[i]);
+              isuccs[q].push_back (std::move (trans));
             }
           }
+          verb_do (1, vout << "Input partitions computed for " << partitions.size ()
+                   /*   */ << " distinct edge labelings over " << aut->num_states ()
+                   /*   */ << " states." << std::endl);
           return isuccs;
         }
 
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <map>
+#include <numeric>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <spot/tl/apcollect.hh>
+#include <spot/tl/formula.hh>
+
+// Groups the conjuncts of a specification into clusters of formulas that
+// share outputs, directly or through other formulas.  Clusters have disjoint
+// outputs, so the conjunction is realizable iff every cluster is, and they
+// never need to be merged to decide realizability.  Returns the cluster of
+// each formula, numbered from 0 in order of first appearance.
+inline std::vector<unsigned> cluster_by_outputs (const std::vector<spot::formula>& formulas,
+                                                 const std::vector<std::string>& output_aps) {
+  std::set<std::string> outputs (output_aps.begin (), output_aps.end ());
+
+  // union-find over the formulas, joined through the first formula that uses
+  // each output
+  std::vector<size_t> parent (formulas.size ());
+  std::iota (parent.begin (), parent.end (), 0);
+  auto find = [&] (size_t i) {
+    while (parent[i] != i)
+      i = parent[i] = parent[parent[i]];
+    return i;
+  };
+
+  std::map<std::string, size_t> owner;
+  for (size_t i = 0; i < formulas.size (); ++i) {
+    spot::atomic_prop_set aps;
+    spot::atomic_prop_collect (formulas[i], &aps);
+    for (const auto& ap : aps) {
+      if (not outputs.contains (ap.ap_name ()))
+        continue;
+      auto [it, inserted] = owner.emplace (ap.ap_name (), i);
+      if (not inserted)
+        parent[find (i)] = find (it->second);
+    }
+  }
+
+  std::map<size_t, unsigned> number;
+  std::vector<unsigned> cluster (formulas.size ());
+  for (size_t i = 0; i < formulas.size (); ++i)
+    cluster[i] = number.emplace (find (i), number.size ()).first->second;
+  return cluster;
+}
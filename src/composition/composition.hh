@@ -4,7 +4,12 @@
 
 #pragma once
 
+#include <algorithm>
+#include <limits>
+
 #include "types.hh"
+#include "aut_preprocessors/simulation.hh"
+#include "utils/cancellation.hh"
 
 // from https://spot.lre.epita.fr/tut21.html
 void custom_print (std::ostream& out, spot::twa_graph_ptr aut)
@@ -61,35 +66,96 @@ void set_rename2(const std::vector<unsigned int>& v, void*) {
 class composition {
   private:
   // the way states are renamed to move boolean states to the end, and also when removing unreachable states (the original initial states before merging)
-  // -1 means the state is no longer there
+  // -1 means the state is no longer there; after a reduction, several states may be renamed to the same one
   std::vector<unsigned int> rename;
   unsigned int aut_size = 0; // number of states in the final merged automaton
+  unsigned int init = 0; // the new initial state in the final merged automaton
+
+  // project the elements of F on the coordinates that survive the merge, F
+  // being a region of the automaton whose states start at first before
+  // renaming; targets receives the new index of each kept coordinate.  Only
+  // the maximal projections are returned.
+  auto project (const GenericDownset& F, size_t first, std::vector<unsigned>& targets) {
+    std::vector<size_t> kept;
+    size_t size = (*F.begin ()).size ();
+    for (size_t i = 0; i < size; ++i)
+      if (rename[first + i] != -1u) {
+        kept.push_back (i);
+        targets.push_back (rename[first + i]);
+      }
 
-  // concatenate two vectors, taking into a account a new initial state is added, + the states are renamed
-  auto combine_vectors (const auto& m1, const auto& m2) {
-    assert (aut_size > 0);
-    auto vec = posets::utils::vector_mm<VECTOR_ELT_T>(aut_size, 0);
+    std::vector<std::vector<VECTOR_ELT_T>> projected;
+    if (kept.empty ()) {
+      projected.emplace_back ();
+      return projected;
+    }
 
-    for (size_t i = 0; i < m1.size (); ++i) {
-      if (rename[i] != -1u) {
-        vec[rename[i]] = m1[i];
-      }
+    auto copy = [&] (const auto& m) {
+      std::vector<VECTOR_ELT_T> vec (kept.size ());
+      for (size_t j = 0; j < kept.size (); ++j)
+        vec[j] = m[kept[j]];
+      return vec;
+    };
+
+    projected.reserve (F.size ());
+    if (kept.size () == size) { // F is already an antichain
+      for (const auto& m : F)
+        projected.push_back (copy (m));
+      return projected;
     }
 
-    for (size_t i = 0; i < m2.size (); ++i) {
-      if (rename[i + m1.size () + 1] != -1u) {
-        vec[rename[i + m1.size () + 1]] = m2[i];
-      }
+    // dropping coordinates can make elements comparable
+    std::vector<GenericDownset::value_type> elements;
+    for (const auto& m : F) {
+      auto vec = posets::utils::vector_mm<VECTOR_ELT_T> (kept.size (), 0);
+      for (size_t j = 0; j < kept.size (); ++j)
+        vec[j] = m[kept[j]];
+      elements.push_back (GenericDownset::value_type (vec));
     }
+    GenericDownset maximal (std::move (elements));
+    for (const auto& m : maximal)
+      projected.push_back (copy (m));
+    return projected;
+  }
+
+  // quotient dest by direct simulation, see aut_preprocessors/simulation.hh,
+  // then put its nonboolean states first again; a state is only boolean if
+  // all the states merged into it are
+  void reduce_aut (safety_game& dest) {
+    unsigned before = dest.aut->num_states ();
+    auto mapping = aut_preprocessors::reduce_by_simulation (dest.aut);
+
+    std::vector<bool> nonbool (dest.aut->num_states (), false);
+    for (unsigned s = 0; s < before; ++s)
+      if (s < dest.bool_threshold and mapping[s] != -1u)
+        nonbool[mapping[s]] = true;
 
-    return GenericDownset::value_type (vec);
+    std::vector<unsigned> order (dest.aut->num_states ());
+    unsigned index_nonbool = 0;
+    unsigned index_bool = std::count (nonbool.begin (), nonbool.end (), true);
+    for (unsigned s = 0; s < order.size (); ++s)
+      order[s] = nonbool[s] ? index_nonbool++ : index_bool++;
+
+    // WARNING: Internal Spot
+    auto& g = dest.aut->get_graph();
+    g.rename_states_(order);
+    dest.aut->set_init_state(order[dest.aut->get_init_state_number()]);
+    g.sort_edges_();
+    g.chain_edges_();
+    dest.bool_threshold = index_nonbool;
+
+    for (auto& r : rename)
+      if (r != -1u)
+        r = mapping[r] == -1u ? -1u : order[mapping[r]];
+    verb_do (1, vout << "Merged automaton reduced from " << before << " to "
+             /*   */ << dest.aut->num_states () << " states\n");
   }
 
   public:
   composition () = default;
 
-  // Merge src automaton into dest
-  void merge_aut (safety_game& dest, safety_game& src) {
+  // Merge src automaton into dest, reducing the result if asked to
+  void merge_aut (safety_game& dest, safety_game& src, bool reduce = false) {
     unsigned int offset = dest.aut->num_states () + 1; // + 1 because of the new init state
 
     // add new initial state which has all transitions of both initial states
@@ -182,17 +248,59 @@ class composition {
     }
 
     dest.bool_threshold += src.bool_threshold + 1;
+    if (reduce)
+      reduce_aut (dest);
     dest.set_globals ();
     aut_size = dest.aut->num_states ();
+    init = dest.aut->get_init_state_number ();
   }
 
 
 
-  auto merge_saferegions (GenericDownset& F1, GenericDownset& F2) {
+  // The product of the projections of F1 and F2 on the surviving
+  // coordinates.  The coordinates of both sides are disjoint, so the product
+  // of two antichains is an antichain, and each combined vector is built
+  // only once, straight into its final place.
+  //
+  // If both games are solved and decoupled, that is, no output is shared
+  // between them, then the product of their safe regions, with the new
+  // initial state absent, is a fixpoint of the merged game, as is the
+  // vector of the new initial state alone; these are then returned.
+  // Otherwise the new initial state is given 0 in every vector, which
+  // overapproximates the safe region.
+  //
+  // States merged by the reduction of merge_aut get the min of their
+  // coordinates: the merged state carries the max of their counters, so a
+  // position of the reduced game is safe iff it is when each of them gets
+  // the value of the merged state.  This keeps overapproximations, but not
+  // the fixpoint of two decoupled games, which are then not reduced.
+  auto merge_saferegions (GenericDownset& F1, GenericDownset& F2, bool decoupled = false) {
+    assert (aut_size > 0);
+    std::vector<unsigned> targets1, targets2;
+    auto P1 = project (F1, 0, targets1);
+    auto P2 = project (F2, (*F1.begin ()).size () + 1, targets2);
+    verb_do (1, vout << "Merging regions: " << F1.size () << " x " << F2.size ()
+             /*   */ << " elements, " << P1.size () << " x " << P2.size ()
+             /*   */ << " after projection\n");
+
     std::vector<GenericDownset::value_type> elements;
-    for(const auto& m1: F1) {
-      for(const auto& m2: F2) {
-        elements.push_back (combine_vectors (m1, m2));
+    elements.reserve (P1.size () * P2.size () + 1);
+    if (decoupled) {
+      auto vec = posets::utils::vector_mm<VECTOR_ELT_T> (aut_size, -1);
+      vec[init] = 0;
+      elements.push_back (GenericDownset::value_type (vec));
+    }
+    for(const auto& m1: P1) {
+      for(const auto& m2: P2) {
+        utils::check_cancelled ();
+        // only the new initial state is not covered by the targets
+        auto vec = posets::utils::vector_mm<VECTOR_ELT_T> (aut_size, std::numeric_limits<VECTOR_ELT_T>::max ());
+        vec[init] = decoupled ? -1 : 0;
+        for (size_t j = 0; j < m1.size (); ++j)
+          vec[targets1[j]] = std::min (vec[targets1[j]], m1[j]);
+        for (size_t j = 0; j < m2.size (); ++j)
+          vec[targets2[j]] = std::min (vec[targets2[j]], m2[j]);
+        elements.push_back (GenericDownset::value_type (vec));
       }
     }
     GenericDownset merged (std::move (elements));
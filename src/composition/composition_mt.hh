@@ -5,12 +5,24 @@
 #pragma once
 #include "types.hh"
 #include "composition.hh"
-#include <queue>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <map>
 #include <fcntl.h>
+#include <poll.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
 #include <thread>
 #include <spot/twaalgos/translate.hh>
 #include "pipes.hh"
+#include "transport.hh"
+#include "merge_scheduler.hh"
+#include "symbolic_safety.hh"
 #include "aut_preprocessors.hh"
+#include "utils/cancellation.hh"
+#include "utils/trace.hh"
+#include "input_pickers/seed.hh"
 
 
 class job_base;
@@ -21,19 +33,57 @@ struct worker_t {
   // two pipes, for communication in both directions
   pipe_t to_main, from_main;
   pid_t pid = -1;
+  bool remote = false; // connected over a socket rather than forked
   bool active = true; // whether the worker has already stopped
+  bool busy = false; // whether the worker is running a job
+  double units = 0; // size of its current job, see job_base::units
+  double max_units = 0; // size of the largest job it ran
+  size_t footprint = 0; // estimated memory needed by its current job
+  job_ptr job; // its current job, shared with the copy of a straggler
+  std::chrono::steady_clock::time_point started; // when it was sent its current job
+  bool stale = false; // whether the other copy of its job finished first, so that its reply is dropped
 };
 
 class composition_mt {
   private:
-  std::queue<job_ptr> pending_jobs; // all currently unfinished jobs no worker is working on yet
-  std::shared_ptr<safety_game> stored_result; // room for temporary result: if there are 2, merge them
+  std::deque<job_ptr> pending_jobs; // all currently unfinished jobs no worker is working on yet
+  merge_schedulers::results_t results; // solved results that still have to be merged
   bool losing = false; // whether the game is already found to be losing (early abort)
 
-  pipe_t shared_pipe; // pipe that all workers use to write a byte to to signify they are done with their job
+  // when checking unrealizability, each cluster is one game for the
+  // environment, and the specification is unrealizable as soon as the
+  // environment wins one of them
+  bool check_real = true;
+  unreal_x_t opt_unreal_x = UNREAL_X_BOTH;
+  bool env_wins = false;
+  bool io_swapped = false; // whether the inputs and outputs are exchanged, for the environment
+
   std::vector<worker_t> workers;
+  size_t next_poll = 0; // where next_result starts looking, so that no worker is starved
+
+  // remote workers connect to listen_addr, see transport.hh
+  std::string listen_addr;
+  int remote_count = 0;
+
+  bool warm = false; // whether to warm up Spot and BuDDy before the first job, see warm_up
+  // whether stragglers are copied; the job times are measured on the wall
+  // clock, and would count the time the process is stopped, see --max-procs
+  bool straggler_copies = true;
 
   bdd invariant = bddtrue;
+  std::map<unsigned, bdd> cluster_invariants; // the part of the invariant that comes from each cluster
+
+  // memory budget for all the running jobs, in bytes, 0 if unlimited; the
+  // footprint of a job is estimated as worker_base + units * bytes_per_unit,
+  // both refined from the peak RSS the workers report
+  size_t mem_budget = 0;
+  size_t worker_base = 0;
+  double bytes_per_unit = 4 * sizeof (VECTOR_ELT_T);
+
+  // time taken by the finished jobs of each kind, in seconds, and their
+  // number, to spot the stragglers; copies of these get their own seed
+  std::map<job_type, std::pair<double, unsigned>> job_times;
+  unsigned next_seed = 0;
 
   // fields borrowed from ltl_processor
   unsigned opt_K, opt_Kmin, opt_Kinc;
@@ -48,14 +98,35 @@ class composition_mt {
 
   spot::formula bdd_to_formula (bdd f) const; // for debugging
   void enqueue (job_ptr p); // add a new job to the queue
-  job_ptr dequeue (); // take a job from the pending jobs queue
 
-  void add_invariant (bdd inv); // add a new invariant
-  void finish_invariant (); // turns the invariant into a solved 2-state automaton, not used right now because the ios-precomputer uses the invariant
+  void add_invariant (bdd inv, unsigned cluster = 0); // add a new invariant, found in cluster
+  void finish_invariant (); // turns the invariant of each cluster into a solved 2-state automaton, only used if the ios-precomputer does not use the invariant
   void solve_game (safety_game& game); // use the k-bounded safety aut to solve a game
   int epilogue (std::string synth_fname, std::string winreg_fname); // look at the final result, call synthesis if needed and return whether it was realizable
   void be_child (int id); // does everything a child process has to do
-  void add_result (safety_game& r); // add a new result to the temporary, or add a merge if there is already one stored
+  void serve (pipe_t& to_main, pipe_t& from_main); // run the jobs read from from_main until told to stop
+  int next_result (int timeout = -1); // wait until a busy worker sends its result, and return its index, or -1 after timeout ms
+  void accept_remote_workers (); // wait for the remote workers and send them the configuration
+  void warm_up (); // prepare a small formula, so that the lazily built state of Spot and BuDDy is ready
+  size_t estimate_footprint (const job_base& job) const; // memory a job is expected to need
+  void learn_footprint (worker_t& worker, size_t rss); // refine the estimates from a worker's peak RSS
+  void dispatch (); // give pending jobs to idle workers, within the memory budget
+  void send_job (worker_t& worker, job_ptr job, unsigned seed); // hand a job to an idle worker
+  void cancel_job (worker_t& worker); // ask a busy worker to drop its job
+  void skip_result (pipe_t& to_main); // read a result and throw it away
+  const worker_t* find_straggler (double& wait) const; // the worker whose job is to be copied now, if any
+  int straggler_timeout () const; // how long next_result may wait before a job is to be copied, in ms
+  void release_idle_workers (); // stop the workers that have no job
+  void drain (); // cancel the running jobs, discard their results and stop all workers
+  void add_result (safety_game& r); // add a new result, to be merged with the others
+  std::optional<std::pair<safety_game, safety_game>> take_merge_pair (); // remove the two results chosen by the scheduler, if any
+  safety_game merge_games (safety_game a, safety_game b); // merge two solved games, solving the result only if they are decoupled
+  bool decoupled (const safety_game& a, const safety_game& b) const; // whether the merge of a and b is solved by their regions
+  std::vector<int> output_vars (bdd f) const; // the outputs in the support of f, sorted
+  void schedule_merges (); // turn results into merge jobs, when the scheduler wants to
+
+  void synthesise_clusters (std::string synth_fname); // one controller per solved cluster, composed in parallel
+  void swap_io (); // exchange the roles of the inputs and outputs
 
   using aut_t = decltype (trans_.run (spot::formula::ff ()));
   aut_t push_outputs (const aut_t& aut, bdd all_inputs, bdd all_outputs);
@@ -70,9 +141,17 @@ class composition_mt {
     trans_(trans), all_inputs(all_inputs), all_outputs(all_outputs),
     input_aps_(input_aps_), output_aps_(output_aps_), init_state(init_state) {}
 
-  void add_formula (spot::formula f); // adds a formula job
+  void add_formula (spot::formula f, unsigned cluster = 0); // adds a formula job, its game will only be merged within its cluster
+  void set_mem_budget (size_t bytes) { mem_budget = bytes; }
+  void set_check (bool real, unreal_x_t unreal_x) { check_real = real; opt_unreal_x = unreal_x; }
+  void set_remote_workers (std::string addr, int count) { listen_addr = addr; remote_count = count; }
+  void set_warm_up (bool w) { warm = w; }
+  void set_straggler_copies (bool copies) { straggler_copies = copies; }
   int run (int workers, std::string synth_fname, std::string winreg_fname); // run everything with the given number of workers
   int run_one (spot::formula f, std::string synth_fname, std::string winreg_fname, bool check_real, unreal_x_t opt_unreal_x); // solve only one formula, with no subprocesses
+
+  // connect to the coordinator at addr and work for it, see set_remote_workers
+  static int remote_worker (const std::string& addr, spot::bdd_dict_ptr dict, spot::translator& trans, bool warm = false);
 };
 
 // abstract base class for jobs
@@ -82,6 +161,9 @@ class job_base {
 
   virtual void to_pipe(pipe_t&) = 0;
   virtual void set_invariant(bdd) = 0;
+  virtual job_type type () const = 0;
+  // size of the game the job works on, as states times elements of the region
+  virtual double units () const { return 0; }
 };
 
 // solve the safety game, changing the downset to the actual safe region instead of
@@ -97,19 +179,39 @@ class job_solve: public job_base {
 
   void to_pipe(pipe_t&) override;
   void set_invariant(bdd) override;
+  job_type type () const override { return j_solve; }
+  double units () const override;
+};
+
+// merge two solved games, then solve the merged game
+class job_merge: public job_base {
+  public:
+  safety_game games[2];
+  bdd invariant;
+
+  public:
+  job_merge (safety_game& a, safety_game& b);
+  ~job_merge () override = default;
+
+  void to_pipe(pipe_t&) override;
+  void set_invariant(bdd) override;
+  job_type type () const override { return j_merge; }
+  double units () const override;
 };
 
 // turn a formula into an automaton with a starting all-k safe region
 class job_formula: public job_base {
   public:
   spot::formula f;
+  unsigned cluster;
 
   public:
-  explicit job_formula (spot::formula f);
+  job_formula (spot::formula f, unsigned cluster);
   ~job_formula () override = default;
 
   void to_pipe(pipe_t&) override;
   void set_invariant(bdd) override;
+  job_type type () const override { return j_formula; }
 };
 
 //////////////////////////////////////////////////
@@ -127,6 +229,7 @@ void job_solve::to_pipe (pipe_t& pipe) {
   // sends the invariant as well to be used when solving
   pipe.write_bdd (invariant, starting_point.aut->get_dict ());
   pipe.write_safety_game (starting_point);
+  pipe.flush ();
   verb_do (1, vout << "Solve job sent: wrote " << pipe.get_bytes_count () << " bytes to pipe\n");
 }
 
@@ -134,14 +237,46 @@ void job_solve::set_invariant (bdd inv) {
   invariant = inv;
 }
 
+double job_solve::units () const {
+  return double (starting_point.aut->num_states ()) * starting_point.safe->size ();
+}
 
-job_formula::job_formula (spot::formula f): f(f) {
+
+job_merge::job_merge (safety_game& a, safety_game& b) {
+  games[0] = a;
+  games[1] = b;
+  invariant = bddtrue;
+}
+
+void job_merge::to_pipe (pipe_t& pipe) {
+  pipe.write_obj<job_type> (j_merge);
+  pipe.write_bdd (invariant, games[0].aut->get_dict ());
+  pipe.write_safety_game (games[0]);
+  pipe.write_safety_game (games[1]);
+  pipe.flush ();
+  verb_do (1, vout << "Merge job sent: wrote " << pipe.get_bytes_count () << " bytes to pipe\n");
+}
+
+void job_merge::set_invariant (bdd inv) {
+  invariant = inv;
+}
+
+double job_merge::units () const {
+  // the merged game, whose region is the product of both regions
+  return (double (games[0].aut->num_states ()) + games[1].aut->num_states () + 1)
+    * games[0].safe->size () * games[1].safe->size ();
+}
+
+
+job_formula::job_formula (spot::formula f, unsigned cluster): f(f), cluster(cluster) {
 
 }
 
 void job_formula::to_pipe (pipe_t& pipe) {
   pipe.write_obj<job_type> (j_formula);
   pipe.write_formula (f);
+  pipe.write_obj<unsigned> (cluster);
+  pipe.flush ();
   verb_do (1, vout << "Formula job sent: wrote " << pipe.get_bytes_count () << " bytes to pipe\n");
 }
 
@@ -193,73 +328,150 @@ spot::formula composition_mt::bdd_to_formula (bdd f) const {
 }
 
 void composition_mt::enqueue (job_ptr p) {
-  pending_jobs.push(p);
+  pending_jobs.push_back (p);
 }
 
-job_ptr composition_mt::dequeue () {
-  if (pending_jobs.empty ()) {
-    // done
-    return nullptr;
-  }
-  auto val = pending_jobs.front ();
-  pending_jobs.pop ();
-  return val;
+void composition_mt::add_result (safety_game& r) {
+  results.push_back (std::make_shared<safety_game> (r));
 }
 
-void composition_mt::add_result (safety_game& r) {
-  if (!stored_result) {
-    stored_result = std::make_shared<safety_game> (r);
-  }
-  else {
-    // merge the stored result, and the new result r
-    safety_game inputs[2];
-    inputs[0] = *stored_result;
-    inputs[1] = r;
+std::optional<std::pair<safety_game, safety_game>> composition_mt::take_merge_pair () {
+  auto picked = MERGE_SCHEDULER::pick (results);
+  if (not picked)
+    return std::nullopt;
+  auto [i, j] = *picked;
+  auto pair = std::pair (*results[i], *results[j]);
+  results.erase (results.begin () + std::max (i, j));
+  results.erase (results.begin () + std::min (i, j));
+  return pair;
+}
 
-    assert (inputs[0].safe);
-    assert (inputs[1].safe);
+safety_game composition_mt::merge_games (safety_game a, safety_game b) {
+  assert (a.safe);
+  assert (b.safe);
+
+  verb_do (1, vout << "Merging games with " << a.aut->num_states () << " and "
+           /*   */ << b.aut->num_states () << " states, and regions of size "
+           /*   */ << a.safe->size () << " and " << b.safe->size () << "\n");
+  verb_do (2, vout << "Merging " << *a.safe << " and " << *b.safe);
+
+  // both regions have to be for the same K
+  int K = std::max (a.K, b.K);
+  a.rescale (K);
+  b.rescale (K);
+
+  bool shortcut = decoupled (a, b);
+
+  auto composer = composition ();
+  {
+    utils::trace::span trace ("merge_aut");
+    trace.arg ("states_a", a.aut->num_states ()).arg ("states_b", b.aut->num_states ());
+    // the fixpoint of decoupled games does not survive a reduction
+    composer.merge_aut (a, b, MERGE_REDUCTION and not shortcut);
+    trace.arg ("states", a.aut->num_states ());
+  }
+  utils::trace::span trace ("merge_saferegions");
+  trace.arg ("region_a", a.safe->size ()).arg ("region_b", b.safe->size ());
+  a.safe = std::make_shared<GenericDownset> (composer.merge_saferegions (*a.safe, *b.safe, shortcut));
+  trace.arg ("region", a.safe->size ());
+  a.solved = shortcut;
+  if (shortcut) {
+    verb_do (1, vout << "Games are decoupled: merged region is solved\n");
+    a.invariant = invariant;
+  }
 
-    verb_do (2, vout << "Merging " << *inputs[0].safe << " and " << *inputs[1].safe);
+  assert (a.safe);
+  verb_do (2, vout << "Merge res: " << *(a.safe));
+  return a;
+}
 
-    auto composer = composition ();
-    composer.merge_aut (inputs[0], inputs[1]);
-    inputs[0].safe = std::make_shared<GenericDownset> (composer.merge_saferegions (*inputs[0].safe, *inputs[1].safe));
-    inputs[0].solved = false;
+std::vector<int> composition_mt::output_vars (bdd f) const {
+  std::vector<int> vars;
+  for (bdd support = bdd_support (f); support != bddtrue; support = bdd_high (support))
+    if ((all_outputs & bdd_nithvar (bdd_var (support))) == bddfalse) // all_outputs is a cube
+      vars.push_back (bdd_var (support));
+  std::sort (vars.begin (), vars.end ());
+  return vars;
+}
 
-    assert (inputs[0].safe);
-    verb_do (2, vout << "Merge res: " << *(inputs[0].safe));
-    verb_do (1, vout << "Done with merge, adding solve job\n");
-    enqueue (std::make_shared<job_solve> (inputs[0]));
+bool composition_mt::decoupled (const safety_game& a, const safety_game& b) const {
+  // both have to be solved with the invariant the merged game would use
+  if (not a.solved or not b.solved or a.invariant != invariant or b.invariant != invariant)
+    return false;
+
+  bdd labels_a = bddtrue, labels_b = bddtrue;
+  for (auto& e : a.aut->edges ())
+    labels_a &= bdd_support (e.cond);
+  for (auto& e : b.aut->edges ())
+    labels_b &= bdd_support (e.cond);
+  auto outs_a = output_vars (labels_a), outs_b = output_vars (labels_b);
+  auto outs_inv = output_vars (invariant);
+
+  auto meet = [] (const std::vector<int>& x, const std::vector<int>& y) {
+    std::vector<int> shared;
+    std::set_intersection (x.begin (), x.end (), y.begin (), y.end (),
+                           std::back_inserter (shared));
+    return not shared.empty ();
+  };
+  // the invariant may constrain the outputs of one side, but not tie both
+  return not meet (outs_a, outs_b) and not (meet (outs_inv, outs_a) and meet (outs_inv, outs_b));
+}
 
-    stored_result = nullptr;
+void composition_mt::schedule_merges () {
+  // a lazy scheduler waits until the workers run out of jobs, so that it
+  // has more results to choose from; the merge itself is done by a worker
+  while (MERGE_SCHEDULER::eager or pending_jobs.empty ()) {
+    auto pair = take_merge_pair ();
+    if (not pair)
+      break;
+    verb_do (1, vout << "Adding merge job\n");
+    enqueue (std::make_shared<job_merge> (pair->first, pair->second));
+    if (not MERGE_SCHEDULER::eager)
+      break;
   }
 }
 
-void composition_mt::add_invariant (bdd inv) {
+void composition_mt::add_invariant (bdd inv, unsigned cluster) {
   invariant &= inv;
+  cluster_invariants.emplace (cluster, bddtrue).first->second &= inv;
   if (invariant == bddfalse) losing = true;
 }
 
-void composition_mt::add_formula (spot::formula f) {
-  enqueue (std::make_shared<job_formula> (f));
+void composition_mt::add_formula (spot::formula f, unsigned cluster) {
+  enqueue (std::make_shared<job_formula> (f, cluster));
 }
 
 void composition_mt::finish_invariant() {
-  // create 2-state solved automaton for all invariants found
-  if (invariant != bddtrue) {
+  // create a 2-state solved automaton for the invariants of each cluster, so
+  // that the clusters are still judged apart
+  for (auto& [cluster, inv] : cluster_invariants) {
+    if (inv == bddtrue)
+      continue;
+    verb_do (1, vout << "Gathered invariants of cluster " << cluster << ": adding invariant "
+             /*   */ << spot::bdd_to_formula (inv, dict) << "\n");
+
+    // the region below is only exact if every input has some output that
+    // satisfies the invariant; otherwise, the environment wins at once
+    if (bdd_forall (bdd_exist (inv, all_outputs), all_inputs) != bddtrue) {
+      verb_do (1, vout << "Invariant cannot be satisfied for some input\n");
+      losing = true;
+      return;
+    }
+
     safety_game invariant_aut;
     invariant_aut.bool_threshold = 1;
+    invariant_aut.cluster = cluster;
 
     spot::twa_graph_ptr aut = new_automaton (dict);
     aut->new_states (2);
     aut->set_init_state (1);
-    verb_do (1, vout << "Gathered invariants: adding invariant " << spot::bdd_to_formula (invariant, dict) << "\n");
 
-    aut->new_edge (1, 1, invariant);
-    aut->new_edge (1, 0, !invariant);
+    aut->new_edge (1, 1, inv);
+    aut->new_edge (1, 0, !inv);
     aut->new_acc_edge (0, 0, bddtrue);
 
     invariant_aut.solved = true;
+    invariant_aut.K = opt_Kmin;
 
     auto safe = posets::utils::vector_mm<VECTOR_ELT_T> (aut->num_states (), 0);
     safe[0] = -1;
@@ -273,6 +485,12 @@ void composition_mt::finish_invariant() {
 void composition_mt::solve_game (safety_game& game) {
   spot::stopwatch sw;
   sw.start ();
+  utils::trace::span trace ("solve");
+  trace.arg ("states", game.aut->num_states ()).arg ("region", game.safe->size ());
+
+  // the environment plays with the inputs and outputs exchanged
+  if (io_swapped == check_real)
+    swap_io ();
 
   auto [nbitsetbools, actual_nonbools] = game.set_globals ();
 
@@ -282,7 +500,7 @@ void composition_mt::solve_game (safety_game& game) {
     posets::vectors::traits<posets::vectors::ARRAY_IMPL, VECTOR_ELT_T>::capacity_for (STATIC_ARRAY_MAX);
 
   if (actual_nonbools <= STATIC_ARRAY_CAP_MAX) { // Array & Bitsets
-    static_switch_t<STATIC_ARRAY_CAP_MAX> {} (
+    static_tier_switch_t<STATIC_ARRAY_TIERS, STATIC_ARRAY_CAP_MAX, array_capacity> {} (
     [&] (auto vnonbools) {
       static_switch_t<STATIC_MAX_BITSETS> {} (
       [&] (auto vbitsets) {
@@ -291,10 +509,11 @@ void composition_mt::solve_game (safety_game& game) {
             posets::vectors::ARRAY_IMPL<VECTOR_ELT_T, std::max (vnonbools.value, 1UL)>,
             vbitsets.value>>;
         auto skn = K_BOUNDED_SAFETY_AUT_IMPL<SpecializedDownset>
-        (game.aut, opt_Kmin, opt_K, opt_Kinc, all_inputs, all_outputs);
+        (game.aut, game.K, opt_K, opt_Kinc, all_inputs, all_outputs);
         assert (game.safe);
         auto current_safe = cast_downset<SpecializedDownset> (*game.safe);
         auto safe = skn.solve (current_safe, invariant, init_state);
+        game.K = skn.current_K ();
         if (safe.has_value ()) {
           game.safe = std::make_shared<GenericDownset> (cast_downset<GenericDownset> (safe.value ()));
         } else game.safe = nullptr;
@@ -313,10 +532,11 @@ void composition_mt::solve_game (safety_game& game) {
       posets::vectors::VECTOR_IMPL<VECTOR_ELT_T>,
       vbitsets.value>>;
       auto skn = K_BOUNDED_SAFETY_AUT_IMPL<SpecializedDownset>
-      (game.aut, opt_Kmin, opt_K, opt_Kinc, all_inputs, all_outputs);
+      (game.aut, game.K, opt_K, opt_Kinc, all_inputs, all_outputs);
       assert (game.safe);
       auto current_safe = cast_downset<SpecializedDownset> (*game.safe);
       auto safe = skn.solve (current_safe, invariant, init_state);
+      game.K = skn.current_K ();
       if (safe.has_value ()) {
         game.safe = std::make_shared<GenericDownset> (cast_downset<GenericDownset> (safe.value ()));
       } else game.safe = nullptr;
@@ -328,18 +548,67 @@ void composition_mt::solve_game (safety_game& game) {
   game.solved = true;
   game.invariant = invariant;
 
+  trace.arg ("K", game.K).arg ("safe", game.safe ? game.safe->size () : 0);
   double solve_time = sw.stop ();
-  verb_do (1, vout << "Safety game solved in " << solve_time << " seconds\n");
+  verb_do (1, vout << "Safety game solved in " << solve_time << " seconds, K = " << game.K << "\n");
 }
 
 int composition_mt::epilogue (std::string synth_fname, std::string winreg_fname) {
+  utils::trace::span trace ("epilogue");
+  // the environment games are never merged: run stops as soon as the
+  // environment wins one, and run_one leaves its only game here
+  if (not check_real) {
+    for (auto& r : results) {
+      if (r->aut == nullptr) { // all states are bounded
+        env_wins = true;
+        break;
+      }
+      if (not r->solved)
+        solve_game (*r);
+      if (r->safe)
+        env_wins = true;
+    }
+    if (not env_wins)
+      utils::vout << "the environment wins none of the games!\n";
+    return env_wins;
+  }
+
   if (losing) {
     utils::vout << "(part of) safety game is not winning!\n";
     return 0;
   }
 
-  // check stored_result
-  if (!stored_result) {
+  // results may be left if no worker was there to solve their merge
+  while (auto pair = take_merge_pair ())
+    results.push_back (std::make_shared<safety_game> (merge_games (pair->first, pair->second)));
+
+  // the clusters have disjoint outputs: the specification is realizable iff
+  // each of them is, and their controllers can be synthesised apart and put
+  // in parallel, unless the invariant, which all of them enforce, ties some
+  // outputs; only the winning region needs the merge of all of them
+  if (winreg_fname.empty () and results.size () > 1
+      and (synth_fname.empty () or output_vars (invariant).empty ())) {
+    for (auto& r : results) {
+      if (not r->solved or (r->invariant != invariant and IOS_PRECOMPUTER::supports_invariant)) {
+        verb_do (1, vout << "Cluster " << r->cluster << " not fully solved -> extra solve\n");
+        solve_game (*r);
+      }
+      if (r->safe == nullptr) {
+        utils::vout << "(part of) safety game is not winning!\n";
+        return 0;
+      }
+    }
+    if (not synth_fname.empty ())
+      synthesise_clusters (synth_fname);
+    return 1;
+  }
+
+  for (auto& r : results)
+    r->cluster = 0;
+  while (auto pair = take_merge_pair ())
+    results.push_back (std::make_shared<safety_game> (merge_games (pair->first, pair->second)));
+
+  if (results.empty ()) {
     // can happen if there are only invariants -> make a dummy automaton with 1 non-accepting state
     safety_game r;
 
@@ -349,6 +618,7 @@ int composition_mt::epilogue (std::string synth_fname, std::string winreg_fname)
     aut->new_edge (0, 0, bddtrue);
 
     r.solved = true;
+    r.K = opt_Kmin;
 
     auto safe = posets::utils::vector_mm<VECTOR_ELT_T> (aut->num_states (), 0);
     safe[0] = 0;
@@ -356,10 +626,10 @@ int composition_mt::epilogue (std::string synth_fname, std::string winreg_fname)
     r.aut = aut;
     r.invariant = invariant;
 
-    stored_result = std::make_shared<safety_game> (r);
+    results.push_back (std::make_shared<safety_game> (r));
   }
 
-  safety_game& r = *stored_result;
+  safety_game& r = *results.front ();
 
   // if the final result was not solved, or it was solved with the wrong invariant (if the IOs precomputer uses it in the first place)
   // then a final solve is needed before calling synthesis
@@ -381,9 +651,11 @@ int composition_mt::epilogue (std::string synth_fname, std::string winreg_fname)
 
   // call synthesis if needed
   if ((r.safe != nullptr) and (not synth_fname.empty () or not winreg_fname.empty ())) {
+    utils::trace::span synthesis ("synthesis");
+    synthesis.arg ("states", r.aut->num_states ()).arg ("region", r.safe->size ());
     r.set_globals ();
     auto skn = K_BOUNDED_SAFETY_AUT_IMPL<GenericDownset>
-      (r.aut, opt_Kmin, opt_K, opt_Kinc, all_inputs, all_outputs);
+      (r.aut, r.K, opt_K, opt_Kinc, all_inputs, all_outputs);
     if (!winreg_fname.empty ())
       skn.winregion (*r.safe, winreg_fname, invariant, init_state);
     if (!synth_fname.empty ())
@@ -394,15 +666,415 @@ int composition_mt::epilogue (std::string synth_fname, std::string winreg_fname)
   return r.safe != nullptr;
 }
 
+void composition_mt::synthesise_clusters (std::string synth_fname) {
+  // each output is set by the cluster that mentions it, the others are 0
+  auto outputs = output_vars (all_outputs);
+  std::vector<int> owner (outputs.size (), -1);
+  std::vector<aiger> parts;
+
+  for (auto& r : results) {
+    bdd support = bddtrue;
+    for (auto& e : r->aut->edges ())
+      support &= bdd_support (e.cond);
+    auto owned = output_vars (support);
+    for (size_t i = 0; i < outputs.size (); ++i)
+      if (std::binary_search (owned.begin (), owned.end (), outputs[i]))
+        owner[i] = parts.size ();
+
+    verb_do (1, vout << "Synthesis for cluster " << r->cluster << "\n");
+    utils::trace::span synthesis ("synthesis");
+    synthesis.arg ("cluster", r->cluster).arg ("states", r->aut->num_states ()).arg ("region", r->safe->size ());
+    r->set_globals ();
+    auto skn = K_BOUNDED_SAFETY_AUT_IMPL<GenericDownset>
+      (r->aut, r->K, opt_K, opt_Kinc, all_inputs, all_outputs);
+    parts.push_back (skn.synthesis_circuit (*r->safe, invariant, init_state));
+  }
+
+  aiger::parallel (parts, owner).save (synth_fname);
+}
+
+// peak resident set size of this process, in bytes
+static size_t peak_rss () {
+  struct rusage usage;
+  getrusage (RUSAGE_SELF, &usage);
+  return size_t (usage.ru_maxrss) * 1024;
+}
+
+size_t composition_mt::estimate_footprint (const job_base& job) const {
+  return worker_base + size_t (job.units () * bytes_per_unit);
+}
+
+void composition_mt::learn_footprint (worker_t& worker, size_t rss) {
+  // the smallest peak seen is what a worker needs before any game
+  if (worker_base == 0 or rss < worker_base)
+    worker_base = rss;
+  // the peak RSS covers every job the worker ran, so it only says something
+  // about the current one if it is the largest so far
+  if (worker.units > 0 and worker.units >= worker.max_units and rss > worker_base)
+    bytes_per_unit = std::max (bytes_per_unit, (rss - worker_base) / worker.units);
+  worker.max_units = std::max (worker.max_units, worker.units);
+}
+
+void composition_mt::dispatch () {
+  for (auto& worker : workers) {
+    if (not worker.active or worker.busy)
+      continue;
+
+    schedule_merges ();
+    if (pending_jobs.empty ()) {
+      // nothing left to start, so help the slowest job with a copy of it
+      double wait;
+      if (auto straggler = find_straggler (wait)) {
+        verb_do (1, vout << "Copying a straggling job\n");
+        send_job (worker, straggler->job, ++next_seed);
+        continue;
+      }
+      break;
+    }
+
+    auto job = pending_jobs.begin ();
+    if (mem_budget > 0) {
+      size_t used = 0;
+      bool running = false;
+      for (const auto& w : workers)
+        if (w.active and w.busy) {
+          used += w.footprint;
+          running = true;
+        }
+      // hold back the jobs that would exceed the budget, unless nothing else
+      // runs: a job too big for the budget is then run alone
+      job = std::find_if (pending_jobs.begin (), pending_jobs.end (),
+                          [&] (const job_ptr& j) {
+                            return not running or used + estimate_footprint (*j) <= mem_budget;
+                          });
+      if (job == pending_jobs.end ()) {
+        verb_do (1, vout << "Holding " << pending_jobs.size () << " jobs back: "
+                 /*   */ << (used >> 20) << "MB of " << (mem_budget >> 20) << "MB in use\n");
+        break;
+      }
+    }
+
+    job_ptr picked = *job;
+    pending_jobs.erase (job);
+    send_job (worker, picked, 0);
+  }
+}
+
+void composition_mt::send_job (worker_t& worker, job_ptr job, unsigned seed) {
+  worker.busy = true;
+  worker.job = job;
+  worker.started = std::chrono::steady_clock::now ();
+  worker.units = job->units ();
+  worker.footprint = estimate_footprint (*job);
+  verb_do (1, vout << "Sending job, estimated at " << (worker.footprint >> 20) << "MB\n");
+  utils::trace::span trace ("send job");
+  trace.arg ("units", worker.units).arg ("seed", seed);
+  job->set_invariant (invariant);
+  // the seed is flushed with the job, as one message
+  worker.from_main.write_obj<job_type> (j_seed);
+  worker.from_main.write_obj<unsigned> (seed);
+  job->to_pipe (worker.from_main);
+}
+
+void composition_mt::cancel_job (worker_t& worker) {
+  // a remote worker can only be told through its connection
+  if (worker.remote) {
+    worker.from_main.write_obj<job_type> (j_cancel);
+    worker.from_main.flush ();
+  }
+  else
+    kill (worker.pid, SIGUSR1);
+}
+
+void composition_mt::skip_result (pipe_t& to_main) {
+  // the result is read all the same, so that its shared memory is released
+  to_main.read_guard (MESSAGE_START);
+  switch (to_main.read_obj<result_type> ()) {
+    case r_game:
+      to_main.read_safety_game (dict);
+      break;
+    case r_invariant:
+      to_main.read_bdd (dict);
+      break;
+    default:
+      break;
+  }
+  to_main.read_obj<size_t> ();
+  to_main.read_guard (MESSAGE_END);
+}
+
+const worker_t* composition_mt::find_straggler (double& wait) const {
+  // a straggler is a solve or merge job that has run STRAGGLER_FACTOR times
+  // longer than the mean of the finished jobs of its kind, and at least a
+  // second; wait is set to the time until the next job becomes one, in
+  // seconds, or to a negative value if none will
+  wait = -1;
+  // with the same seed, a copy would only repeat the work of the job
+  if (STRAGGLER_FACTOR <= 0 or not INPUT_PICKER::uses_seed or not straggler_copies)
+    return nullptr;
+
+  size_t used = 0;
+  for (const auto& w : workers)
+    if (w.active and w.busy)
+      used += w.footprint;
+
+  auto now = std::chrono::steady_clock::now ();
+  const worker_t* straggler = nullptr;
+  for (const auto& w : workers) {
+    // translation does not depend on the seed, a copy would do the same
+    if (not w.active or not w.busy or w.stale or w.job->type () == j_formula)
+      continue;
+    auto times = job_times.find (w.job->type ());
+    if (times == job_times.end ())
+      continue;
+    // a job is copied once, and only if the copy fits in the memory budget
+    auto copies = std::count_if (workers.begin (), workers.end (),
+                                 [&] (const worker_t& o) {
+                                   return o.active and o.busy and o.job == w.job;
+                                 });
+    if (copies > 1 or (mem_budget > 0 and used + w.footprint > mem_budget))
+      continue;
+
+    auto [total, count] = times->second;
+    double left = std::max (1.0, STRAGGLER_FACTOR * total / count)
+      - std::chrono::duration<double> (now - w.started).count ();
+    if (left > 0) {
+      if (wait < 0 or left < wait)
+        wait = left;
+    }
+    else if (not straggler or w.started < straggler->started)
+      straggler = &w;
+  }
+  return straggler;
+}
+
+int composition_mt::straggler_timeout () const {
+  // copies are only started by idle workers, once there is nothing else to do
+  bool idle = std::any_of (workers.begin (), workers.end (),
+                           [] (const worker_t& w) { return w.active and not w.busy; });
+  if (not idle or not pending_jobs.empty ())
+    return -1;
+  double wait;
+  if (find_straggler (wait))
+    return 0;
+  return wait < 0 ? -1 : int (wait * 1000) + 1;
+}
+
+void composition_mt::release_idle_workers () {
+  for(size_t i = 0; i < workers.size (); i++) {
+    if (!workers[i].active or workers[i].busy) continue;
+    workers[i].active = false;
+    verb_do (1, vout << "Releasing worker " << i << "\n");
+
+    workers[i].from_main.write_obj<job_type> (j_done);
+    workers[i].from_main.flush ();
+    if (workers[i].remote)
+      close (workers[i].from_main.w);
+    else
+      // wait for this process
+      waitpid (workers[i].pid, nullptr, 0);
+  }
+}
+
+int composition_mt::next_result (int timeout) {
+  std::vector<pollfd> fds;
+  std::vector<size_t> ids;
+  for (size_t k = 0; k < workers.size (); ++k) {
+    size_t i = (next_poll + k) % workers.size ();
+    if (workers[i].active and workers[i].busy) {
+      fds.push_back ({workers[i].to_main.r, POLLIN, 0});
+      ids.push_back (i);
+    }
+  }
+  assert (not fds.empty ());
+
+  int ready;
+  while ((ready = poll (fds.data (), fds.size (), timeout)) < 0)
+    if (errno != EINTR)
+      error (2, errno, "cannot wait for the workers");
+  if (ready == 0)
+    return -1;
+
+  for (size_t k = 0; k < fds.size (); ++k)
+    if (fds[k].revents) {
+      next_poll = ids[k] + 1;
+      return ids[k];
+    }
+  assert (false);
+  return -1;
+}
+
+void composition_mt::warm_up () {
+  // the translator, its simplifier and the BuDDy node table and caches are
+  // built lazily, by the first formula; going through the whole preparation
+  // with a formula over the inputs and outputs builds them all, without
+  // registering new APs
+  spot::stopwatch sw;
+  sw.start ();
+  utils::trace::span trace ("warm up");
+
+  std::vector<spot::formula> ins, outs;
+  for (const auto& ap : input_aps_)
+    ins.push_back (spot::formula::ap (ap));
+  for (const auto& ap : output_aps_)
+    outs.push_back (spot::formula::ap (ap));
+  auto f = spot::formula::Implies (spot::formula::G (spot::formula::F (spot::formula::Or (ins))),
+                                   spot::formula::G (spot::formula::F (spot::formula::Or (outs))));
+  prepare_formula (f, check_real, opt_unreal_x);
+  // the environment's preparation leaves the roles exchanged, and the remote
+  // workers are sent them afterwards
+  if (io_swapped)
+    swap_io ();
+
+  verb_do (1, vout << "Warmed up in " << sw.stop () << " seconds\n");
+}
+
+void composition_mt::accept_remote_workers () {
+  if (remote_count == 0)
+    return;
+
+  int listen_fd = transport::listen_on (listen_addr);
+  verb_do (1, vout << "Waiting for " << remote_count << " workers on " << listen_addr << "\n");
+  for (int i = 0; i < remote_count; ++i) {
+    int fd = transport::accept_from (listen_fd);
+    transport::handshake (fd, "worker " + std::to_string (workers.size () + 1));
+    worker_t& worker = workers.emplace_back ();
+    worker.remote = true;
+    worker.to_main.r = worker.from_main.w = fd;
+    worker.to_main.shared_memory = worker.from_main.shared_memory = transport::is_local (listen_addr);
+
+    // everything a worker needs to build its own composition_mt
+    pipe_t& pipe = worker.from_main;
+    pipe.write_obj<unsigned> (opt_K);
+    pipe.write_obj<unsigned> (opt_Kmin);
+    pipe.write_obj<unsigned> (opt_Kinc);
+    pipe.write_obj<char> (check_real);
+    pipe.write_obj<unreal_x_t> (opt_unreal_x);
+    pipe.write_obj<size_t> (input_aps_.size ());
+    for (const auto& ap : input_aps_)
+      pipe.write_string (ap);
+    pipe.write_obj<size_t> (output_aps_.size ());
+    for (const auto& ap : output_aps_)
+      pipe.write_string (ap);
+    pipe.flush ();
+    verb_do (1, vout << "Worker " << workers.size () << " connected\n");
+  }
+  close (listen_fd);
+}
+
+void composition_mt::drain () {
+  int running = 0;
+  for (auto& w : workers)
+    if (w.active and w.busy) {
+      cancel_job (w);
+      running++;
+    }
+  verb_do (1, vout << "Cancelling " << running << " running jobs\n");
+
+  // each of them replies once, with its result or the cancellation; the
+  // steps that do not look at the token, such as translations, are not
+  // waited for past a grace period
+  auto deadline = std::chrono::steady_clock::now () + std::chrono::milliseconds (CANCEL_GRACE);
+  for (; running > 0; running--) {
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds> (deadline - std::chrono::steady_clock::now ());
+    int wid = next_result (std::max (int (left.count ()), 0));
+    if (wid < 0)
+      break;
+    workers[wid].busy = false;
+    workers[wid].stale = false;
+    skip_result (workers[wid].to_main);
+  }
+
+  for (size_t i = 0; i < workers.size (); ++i) {
+    auto& w = workers[i];
+    if (not w.active or not w.busy)
+      continue;
+    verb_do (1, vout << "Killing worker " << i << ", its job did not stop in time\n");
+    if (w.remote)
+      // the worker sees its connection closed and stops
+      close (w.to_main.r);
+    else {
+      kill (w.pid, SIGKILL);
+      waitpid (w.pid, nullptr, 0);
+      shm_segments::cleanup_of (w.pid);
+    }
+    w.active = w.busy = false;
+    w.job.reset ();
+  }
+
+  pending_jobs.clear ();
+  release_idle_workers ();
+}
+
+int composition_mt::remote_worker (const std::string& addr, spot::bdd_dict_ptr dict, spot::translator& trans, bool warm) {
+  utils::vout.set_prefix ("[remote] ");
+
+  int fd = transport::connect_to (addr);
+  transport::handshake (fd, addr);
+  pipe_t to_main, from_main;
+  to_main.w = from_main.r = fd;
+  to_main.shared_memory = from_main.shared_memory = transport::is_local (addr);
+
+  // the configuration sent by accept_remote_workers
+  unsigned K = from_main.read_obj<unsigned> ();
+  unsigned Kmin = from_main.read_obj<unsigned> ();
+  unsigned Kinc = from_main.read_obj<unsigned> ();
+  bool real = from_main.read_obj<char> ();
+  unreal_x_t unreal_x = from_main.read_obj<unreal_x_t> ();
+  // the IO variables are kept for as long as the worker runs
+  char io_owner;
+  auto read_aps = [&] (bdd& all) {
+    std::vector<std::string> aps (from_main.read_obj<size_t> ());
+    all = bddtrue;
+    for (auto& ap : aps) {
+      ap = from_main.read_string ();
+      all &= bdd_ithvar (dict->register_proposition (spot::formula::ap (ap), &io_owner));
+    }
+    return aps;
+  };
+  bdd all_inputs, all_outputs;
+  auto input_aps = read_aps (all_inputs);
+  auto output_aps = read_aps (all_outputs);
+  verb_do (1, vout << "Connected to " << addr << "\n");
+
+  composition_mt composer (K, Kmin, Kinc, dict, trans, all_inputs, all_outputs,
+                           input_aps, output_aps, {});
+  composer.set_check (real, unreal_x);
+  utils::trace::set_process ("remote worker");
+  // done before the first job rather than during it
+  if (warm)
+    composer.warm_up ();
+  // the coordinator cancels a job by sending a message
+  utils::cancel_fd = fd;
+  composer.serve (to_main, from_main);
+  dict->unregister_all_my_variables (&io_owner);
+  return 0;
+}
+
 void composition_mt::be_child (int id) {
   utils::vout.set_prefix ("[" + std::to_string (id+1) + "] ");
+  utils::trace::set_track (id + 1, "worker " + std::to_string (id + 1));
+  serve (workers[id].to_main, workers[id].from_main);
+}
 
-  pipe_t& to_main = workers[id].to_main;
-  pipe_t& from_main = workers[id].from_main;
+void composition_mt::serve (pipe_t& to_main, pipe_t& from_main) {
+  // tell the coordinator that the job was dropped
+  auto send_cancelled = [&] () {
+    verb_do (1, vout << "Job cancelled\n");
+    to_main.write_guard (MESSAGE_START);
+    to_main.write_obj<result_type> (r_cancelled);
+    to_main.write_obj<size_t> (peak_rss ());
+    to_main.write_guard (MESSAGE_END);
+    to_main.flush ();
+  };
 
   // keep reading jobs until we are done
   while (true) {
+    utils::trace::span idle ("idle");
     job_type job = from_main.read_obj<job_type> ();
+    idle.end ();
+    // a cancellation sent while idle was meant for the previous job
+    utils::reset_cancel ();
 
     switch (job) {
       case j_done: {
@@ -411,55 +1083,139 @@ void composition_mt::be_child (int id) {
         break;
       }
 
+      case j_seed:
+        // for the input picker of the job that follows
+        input_pickers::seed = from_main.read_obj<unsigned> ();
+        break;
+
+      case j_cancel:
+        // the job it was meant for is already over
+        break;
+
       case j_solve: {
+        utils::trace::span trace ("job_solve"), reading ("read job");
         // update invariant
         invariant = from_main.read_bdd (dict);
 
         // solve job
         safety_game r = from_main.read_safety_game (dict);
-        verb_do (1, vout << "Solve job received: read " << from_main.get_bytes_count () << " bytes from pipe\n");
+        size_t bytes = from_main.get_bytes_count ();
+        reading.arg ("bytes", bytes).end ();
+        verb_do (1, vout << "Solve job received: read " << bytes << " bytes from pipe\n");
         verb_do (1, vout << "Starting solve on automaton with " << r.aut->num_states() << " states\n");
 
-        solve_game (r);
+        try {
+          solve_game (r);
+        } catch (const utils::cancelled&) {
+          send_cancelled ();
+          break;
+        }
+
+        utils::trace::span writing ("write result");
+        writing.arg ("states", r.aut->num_states ()).arg ("region", r.safe ? r.safe->size () : 0);
+        to_main.write_guard (MESSAGE_START);
+        to_main.write_obj<result_type> (r_game);
+        to_main.write_safety_game (r);
+        to_main.write_obj<size_t> (peak_rss ());
+        to_main.write_guard (MESSAGE_END);
+        to_main.flush ();
+
+        bytes = to_main.get_bytes_count ();
+        writing.arg ("bytes", bytes);
+        verb_do (1, vout << "Done: wrote " << bytes << " bytes to pipe\n");
+        break;
+      }
+
+      case j_merge: {
+        utils::trace::span trace ("job_merge"), reading ("read job");
+        invariant = from_main.read_bdd (dict);
+
+        // merge job: merge both games and solve the result
+        safety_game a = from_main.read_safety_game (dict);
+        safety_game b = from_main.read_safety_game (dict);
+        size_t bytes = from_main.get_bytes_count ();
+        reading.arg ("bytes", bytes).end ();
+        verb_do (1, vout << "Merge job received: read " << bytes << " bytes from pipe\n");
+
+        safety_game r;
+        try {
+          r = merge_games (a, b);
+          if (not r.solved) {
+            verb_do (1, vout << "Starting solve on automaton with " << r.aut->num_states() << " states\n");
+            solve_game (r);
+          }
+        } catch (const utils::cancelled&) {
+          send_cancelled ();
+          break;
+        }
 
-        shared_pipe.write_obj<char> (id);
+        utils::trace::span writing ("write result");
+        writing.arg ("states", r.aut->num_states ()).arg ("region", r.safe ? r.safe->size () : 0);
         to_main.write_guard (MESSAGE_START);
         to_main.write_obj<result_type> (r_game);
         to_main.write_safety_game (r);
+        to_main.write_obj<size_t> (peak_rss ());
         to_main.write_guard (MESSAGE_END);
+        to_main.flush ();
 
-        verb_do (1, vout << "Done: wrote " << to_main.get_bytes_count () << " bytes to pipe\n");
+        bytes = to_main.get_bytes_count ();
+        writing.arg ("bytes", bytes);
+        verb_do (1, vout << "Done: wrote " << bytes << " bytes to pipe\n");
         break;
       }
 
       case j_formula: {
+        utils::trace::span trace ("job_formula");
         // turn formula into automaton
         spot::formula f = from_main.read_formula ();
-        verb_do (1, vout << "Formula job received: read " << from_main.get_bytes_count () << " bytes from pipe\n");
+        unsigned cluster = from_main.read_obj<unsigned> ();
+        size_t bytes = from_main.get_bytes_count ();
+        verb_do (1, vout << "Formula job received: read " << bytes << " bytes from pipe\n");
         verb_do (1, vout << "Formula to be converted: " << f << "\n");
 
-        safety_game r = prepare_formula (f);
+        safety_game r = prepare_formula (f, check_real, opt_unreal_x);
+        r.cluster = cluster;
+        trace.arg ("states", r.aut ? r.aut->num_states () : 0);
+
+        bdd condition;
+        bool is_inv = r.aut and check_real and is_invariant (r.aut, condition);
+        // the other safety conjuncts are solved right away, without merging
+        // their whole automaton
+        if (SYMBOLIC_SAFETY > 0 and r.aut and check_real and not is_inv
+            and symbolic_safety::applies (r.aut)) {
+          utils::trace::span solving ("symbolic safety");
+          try {
+            if (symbolic_safety::solve (r, all_inputs, all_outputs, SYMBOLIC_SAFETY))
+              verb_do (1, vout << "Safety conjunct solved symbolically, region of size "
+                       /*   */ << (r.safe ? r.safe->size () : 0) << "\n");
+          } catch (const utils::cancelled&) {
+            send_cancelled ();
+            break;
+          }
+        }
 
-        shared_pipe.write_obj<char> (id);
+        utils::trace::span writing ("write result");
         to_main.write_guard (MESSAGE_START);
 
-        if (r.aut) {
-          bdd condition;
-          if (is_invariant (r.aut, condition)) {
-            to_main.write_obj<result_type> (r_invariant);
-            to_main.write_bdd (condition, dict);
-          } else {
-            to_main.write_obj<result_type> (r_game);
-            to_main.write_safety_game (r);
-          }
+        if (is_inv) {
+          to_main.write_obj<result_type> (r_invariant);
+          to_main.write_bdd (condition, dict);
+        } else if (r.aut or not check_real) {
+          // without an automaton, the environment wins trivially
+          to_main.write_obj<result_type> (r_game);
+          to_main.write_safety_game (r);
         } else {
           // trivial formula (automaton with no accepting states, like "G true")
           to_main.write_obj<result_type> (r_null);
         }
 
+        to_main.write_obj<size_t> (peak_rss ());
         to_main.write_guard (MESSAGE_END);
+        to_main.flush ();
 
-        verb_do (1, vout << "Done: wrote " << to_main.get_bytes_count () << " bytes to pipe\n");
+        bytes = to_main.get_bytes_count ();
+        writing.arg ("bytes", bytes);
+        verb_do (1, vout << "Done: wrote " << bytes << " bytes to pipe\n");
         break;
       }
 
@@ -474,23 +1230,24 @@ void composition_mt::be_child (int id) {
 
 int composition_mt::run (int worker_count, std::string synth_fname, std::string winreg_fname) {
   verb_do (1, utils::vout.set_prefix ("[0] "));
+  utils::trace::set_track (0, "coordinator");
 
-  if (worker_count <= 0) {
+  // with remote workers, local ones are only used if asked for
+  if (worker_count <= 0 and remote_count == 0) {
     worker_count = std::thread::hardware_concurrency ();
   }
+  worker_count = std::max (worker_count, 0);
   worker_count = std::min<int> (worker_count, 255);
   worker_count = std::min<int> (worker_count, pending_jobs.size ());
-  verb_do (1, vout << "Workers: " << worker_count << "\n");
+  verb_do (1, vout << "Workers: " << worker_count << " local, " << remote_count << " remote\n");
 
-  assert (worker_count > 0);
-
-  // create shared pipe
-  assert (shared_pipe.create_pipe () == 0);
+  assert (worker_count + remote_count > 0);
 
   workers.resize (worker_count);
   for(int i = 0; i < worker_count; i++) {
-    assert (workers[i].to_main.create_pipe () == 0);
-    assert (workers[i].from_main.create_pipe () == 0);
+    if (workers[i].to_main.create_pipe () != 0 or
+        workers[i].from_main.create_pipe () != 0)
+      error (2, errno, "cannot create pipe");
   }
 
   // how many formula jobs aren't yet solved: once this is 0, add invariants, if not using ios precomputer that uses the invariant
@@ -502,34 +1259,81 @@ int composition_mt::run (int worker_count, std::string synth_fname, std::string
     verb_do (1, vout << "IOs precomputer supports invariant\n");
   }
 
-  // spawn the workers with their initial job
+  // installed before forking, so that no worker can be killed by an early
+  // cancellation
+  utils::cancel_on (SIGUSR1);
+
+  // done once here, the workers inherit it
+  if (warm and worker_count > 0)
+    warm_up ();
+
+  // spawn the workers, then hand them their initial job
+  pid_t coordinator = getpid ();
   for(int i = 0; i < worker_count; i++) {
     pid_t pid = fork ();
     assert (pid >= 0);
 
     if (pid > 0) {
       workers[i].pid = pid;
-      job_ptr job = dequeue ();
-      assert (job != nullptr);
-
-      job->to_pipe (workers[i].from_main);
     }
     else {
-      // child process
+      // child process; it is of no use without its coordinator, which may be
+      // killed while they are stopped, see --max-procs
+      prctl (PR_SET_PDEATHSIG, SIGKILL);
+      if (getppid () != coordinator)
+        _exit (3);
       be_child (i);
     }
   }
+  accept_remote_workers ();
+  dispatch ();
+
+  auto busy_workers = [&] () {
+    return std::count_if (workers.begin (), workers.end (),
+                          [] (const worker_t& w) { return w.active and w.busy; });
+  };
+
+  // wait until a worker sends its result
+  while (busy_workers () > 0) {
+    utils::trace::span waiting ("wait");
+    int wid = next_result (straggler_timeout ());
+    waiting.end ();
+
+    // no result yet, but a job now runs for too long
+    if (wid < 0) {
+      dispatch ();
+      continue;
+    }
 
-  int active_workers = worker_count;
-
-
-  // wait until a process writes to the shared pipe that it's writing its result
-  while (active_workers > 0) {
-    int wid = shared_pipe.read_obj<char> ();
-    assert ((wid >= 0) && (wid < worker_count));
+    worker_t& worker = workers[wid];
+    pipe_t& to_main = worker.to_main;
+    worker.busy = false;
+
+    if (worker.stale) {
+      verb_do (1, vout << "Dropping the reply of worker " << wid << ", its job was done by a copy\n");
+      worker.stale = false;
+      worker.job.reset ();
+      skip_result (to_main);
+      dispatch ();
+      continue;
+    }
 
-    pipe_t& to_main = workers[wid].to_main;
-    pipe_t& from_main = workers[wid].from_main;
+    // the first copy of a job to finish wins, the other one is cancelled
+    for (auto& w : workers)
+      if (&w != &worker and w.active and w.busy and w.job == worker.job) {
+        cancel_job (w);
+        w.stale = true;
+      }
+    utils::trace::span reading ("read result");
+    reading.arg ("worker", wid + 1);
+    auto& [total, count] = job_times[worker.job->type ()];
+    total += std::chrono::duration<double> (std::chrono::steady_clock::now () - worker.started).count ();
+    count++;
+    job_type done = worker.job->type ();
+    unsigned cluster = 0;
+    if (done == j_formula)
+      cluster = std::static_pointer_cast<job_formula> (worker.job)->cluster;
+    worker.job.reset ();
 
     to_main.read_guard (MESSAGE_START);
     result_type res = to_main.read_obj<result_type> ();
@@ -538,8 +1342,22 @@ int composition_mt::run (int worker_count, std::string synth_fname, std::string
       case r_game: {
       safety_game game = to_main.read_safety_game (dict);
 
-        if (game.safe) {
+        if (not check_real) {
+          if (game.aut == nullptr or (game.solved and game.safe)) {
+            env_wins = true;
+            verb_do (1, vout << "Environment wins cluster " << game.cluster << " -> abort!\n");
+          } else if (not game.solved) {
+            base_remaining--;
+            verb_do (1, vout << "Unsolved game -> add solve job\n");
+            enqueue (std::make_shared<job_solve> (game));
+          } else {
+            verb_do (1, vout << "Environment loses cluster " << game.cluster << "\n");
+          }
+        } else if (game.safe) {
           if (game.solved) {
+            // safety conjuncts come solved from their formula job
+            if (done == j_formula)
+              base_remaining--;
             verb_do (1, vout << "Solved game -> add as result\n");
             add_result (game);
           } else {
@@ -558,7 +1376,7 @@ int composition_mt::run (int worker_count, std::string synth_fname, std::string
         base_remaining--;
         bdd inv = to_main.read_bdd (dict);
         verb_do (1, vout << "Read invariant: " << bdd_to_formula (inv) << "\n");
-        add_invariant (inv);
+        add_invariant (inv, cluster);
         break;
       }
 
@@ -568,11 +1386,16 @@ int composition_mt::run (int worker_count, std::string synth_fname, std::string
         break;
       }
 
+      case r_cancelled:
+        break;
+
       default:
         assert (false);
     }
 
+    learn_footprint (worker, to_main.read_obj<size_t> ());
     to_main.read_guard (MESSAGE_END);
+    reading.end ();
 
     // if the ios precomputer does not use the invariants, we need to add an automaton that encodes all the invariants
     if constexpr (! IOS_PRECOMPUTER::supports_invariant) {
@@ -582,35 +1405,21 @@ int composition_mt::run (int worker_count, std::string synth_fname, std::string
       }
     }
 
-    // kill all workers and immediately abort if found to be losing
-    if (losing) {
-      for(int i = 0; i < worker_count; i++) {
-        if (!workers[i].active) continue;
-        kill (workers[i].pid, SIGKILL);
-        waitpid (workers[i].pid, nullptr, 0);
-      }
+    // stop the running jobs and abort if the answer is known
+    if (losing or env_wins) {
+      drain ();
       break;
     }
 
     verb_do (1, vout << "Done: read " << to_main.get_bytes_count () << " bytes from pipe\n");
 
-    job_ptr new_job = dequeue ();
-
-    if (new_job == nullptr) {
-      active_workers--;
-      verb_do (1, vout << "Releasing worker " << wid << ": " << active_workers << " left.\n");
-      workers[wid].active = false;
-
-      from_main.write_obj<job_type> (j_done);
-      // wait for this process
-      waitpid (workers[wid].pid, nullptr, 0);
-    } else {
-      // send new job
-      new_job->set_invariant (invariant);
-      new_job->to_pipe (from_main);
-    }
+    dispatch ();
   }
 
+  // idle workers are kept until the end, for the merges and the copies of
+  // stragglers that may come
+  release_idle_workers ();
+
 
   verb_do (1, vout << "All workers are finished.\n");
 
@@ -619,6 +1428,7 @@ int composition_mt::run (int worker_count, std::string synth_fname, std::string
 
 int composition_mt::run_one (spot::formula f, std::string synth_fname, std::string winreg_fname,
                              bool check_real, unreal_x_t opt_unreal_x) {
+  set_check (check_real, opt_unreal_x);
   safety_game game = prepare_formula (f, check_real, opt_unreal_x);
   add_result (game);
   return epilogue (synth_fname, winreg_fname);
@@ -666,8 +1476,17 @@ composition_mt::aut_t composition_mt::push_outputs (const composition_mt::aut_t&
   return ret;
 }
 
+void composition_mt::swap_io () {
+  input_aps_.swap (output_aps_);
+  std::swap (all_inputs, all_outputs);
+  io_swapped = not io_swapped;
+}
+
 safety_game composition_mt::prepare_formula (spot::formula f, bool check_real, unreal_x_t opt_unreal_x) {
-  // Note: this function is only run once with unrealizability as there is no composition -> swapping the inputs/outputs only happens once
+  // the environment games of the clusters may be prepared by the same
+  // process: start from the original roles, they are swapped again below
+  if (io_swapped)
+    swap_io ();
 
   spot::process_timer timer;
   timer.start ();
@@ -701,8 +1520,7 @@ safety_game composition_mt::prepare_formula (spot::formula f, bool check_real, u
     };
     f = f.map ([&] (spot::formula t) { return rec (rec, t); });
     // Swap I and O.
-    input_aps_.swap (output_aps_);
-    std::swap (all_inputs, all_outputs);
+    swap_io ();
   }
 
   verb_do (1, vout << "Formula: " << f << std::endl);
@@ -712,8 +1530,7 @@ safety_game composition_mt::prepare_formula (spot::formula f, bool check_real, u
   // If unreal but we haven't pushed outputs yet using X on formula
   if (not check_real and opt_unreal_x == UNREAL_X_AUTOMATON) {
     aut = push_outputs (aut, all_inputs, all_outputs);
-    input_aps_.swap (output_aps_);
-    std::swap (all_inputs, all_outputs);
+    swap_io ();
   }
 
   if (want_time) {
@@ -779,6 +1596,7 @@ safety_game composition_mt::prepare_formula (spot::formula f, bool check_real, u
   ret.aut = aut;
   ret.bool_threshold = posets::vectors::bool_threshold;
   ret.solved = false;
+  ret.K = opt_Kmin;
   ret.set_globals ();
 
   auto all_k = posets::utils::vector_mm<VECTOR_ELT_T> (aut->num_states (), opt_Kmin - 1);
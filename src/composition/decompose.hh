@@ -0,0 +1,26 @@
+#pragma once
+
+#include <vector>
+
+#include <spot/tl/formula.hh>
+
+// Splits f into formulas whose conjunction is equivalent to f, so that they
+// can be composed instead of translated as a whole: the operands of a
+// top-level And, G (a & b) into G a and G b, and A -> (g1 & g2) into A -> g1
+// and A -> g2.  The parts are split again recursively.
+inline void decompose (spot::formula f, std::vector<spot::formula>& parts) {
+  if (f.is (spot::op::And)) {
+    for (auto g : f)
+      decompose (g, parts);
+  }
+  else if (f.is (spot::op::G) and f[0].is (spot::op::And)) {
+    for (auto g : f[0])
+      decompose (spot::formula::G (g), parts);
+  }
+  else if (f.is (spot::op::Implies) and f[1].is (spot::op::And)) {
+    for (auto g : f[1])
+      decompose (spot::formula::Implies (f[0], g), parts);
+  }
+  else
+    parts.push_back (f);
+}
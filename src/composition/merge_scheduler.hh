@@ -0,0 +1,86 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "types.hh"
+
+// Policies that choose which two solved components composition_mt merges
+// next.  pick () returns two distinct indices into the results, of games in
+// the same cluster, if there are any; eager says whether merging happens as
+// soon as such a pair is there, or only when there is no other job left for
+// the workers.
+namespace merge_schedulers {
+  using results_t = std::vector<std::shared_ptr<safety_game>>;
+
+  using pick_t = std::optional<std::pair<size_t, size_t>>;
+
+  // merge in arrival order
+  struct arrival {
+      static constexpr bool eager = true;
+
+      static pick_t pick (const results_t& results) {
+        for (size_t j = 1; j < results.size (); ++j)
+          for (size_t i = 0; i < j; ++i)
+            if (results[i]->cluster == results[j]->cluster)
+              return std::pair (i, j);
+        return std::nullopt;
+      }
+  };
+
+  // merge the pair whose product is expected to be the cheapest, as in the
+  // construction of a Huffman tree, so that the big components are only
+  // merged at the end; ties go to the pair sharing the most APs
+  struct cheapest_pair {
+      static constexpr bool eager = false;
+
+      // the merged region is the product of both regions, and each element
+      // has one coordinate per state
+      static double cost (const safety_game& a, const safety_game& b) {
+        return (double (a.aut->num_states ()) + b.aut->num_states () + 1)
+          * a.safe->size () * b.safe->size ();
+      }
+
+      static std::vector<int> support_vars (const safety_game& g) {
+        bdd support = bddtrue;
+        for (auto& e : g.aut->edges ())
+          support &= bdd_support (e.cond);
+        std::vector<int> vars;
+        for (; support != bddtrue; support = bdd_high (support))
+          vars.push_back (bdd_var (support));
+        std::sort (vars.begin (), vars.end ());
+        return vars;
+      }
+
+      static pick_t pick (const results_t& results) {
+        std::vector<std::vector<int>> supports;
+        for (const auto& r : results)
+          supports.push_back (support_vars (*r));
+
+        pick_t best;
+        double best_cost = std::numeric_limits<double>::infinity ();
+        size_t best_overlap = 0;
+
+        for (size_t i = 0; i < results.size (); ++i)
+          for (size_t j = i + 1; j < results.size (); ++j) {
+            if (results[i]->cluster != results[j]->cluster)
+              continue;
+            double c = cost (*results[i], *results[j]);
+            std::vector<int> shared;
+            std::set_intersection (supports[i].begin (), supports[i].end (),
+                                   supports[j].begin (), supports[j].end (),
+                                   std::back_inserter (shared));
+            if (not best or c < best_cost or (c == best_cost and shared.size () > best_overlap)) {
+              best = std::pair (i, j);
+              best_cost = c;
+              best_overlap = shared.size ();
+            }
+          }
+        return best;
+      }
+  };
+}
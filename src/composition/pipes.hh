@@ -4,12 +4,27 @@
 
 #pragma once
 
+#include <dirent.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #include <cassert>
+#include <cerrno>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
 #include <sstream>
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <unordered_map>
+#include <vector>
 #include <spot/tl/parse.hh>
 
 #include "types.hh"
+#include "../error_msg.hh"
 
 // magic values
 const int MESSAGE_START = 0x4603C330;
@@ -33,7 +48,56 @@ const int FORMULA_END = 0x198AB311;
 const int STRING_START = 0x093184CD;
 const int STRING_END = 0x5E183BD2;
 
+// The shared memory segments of the downsets, see pipe_t::write_downset, are
+// named after the process that creates them.  Their reader unlinks them; if
+// it never does, say because it was killed, the segments are unlinked when
+// their creator ends, or, if their creator was killed, by its parent.
+namespace shm_segments {
+  inline std::string prefix (pid_t pid) {
+    return "acacia-bonsai-" + std::to_string (pid) + "-";
+  }
+
+  // the names of the segments this process created; forked processes inherit
+  // those of their parent, hence the check of the prefix
+  inline std::vector<std::string> created;
+
+  inline void cleanup () {
+    auto own = "/" + prefix (getpid ());
+    for (const auto& name : created)
+      if (name.starts_with (own))
+        shm_unlink (name.c_str ()); // fails harmlessly if already read
+    created.clear ();
+  }
+
+  inline void add (const std::string& name) {
+    static bool registered = false;
+    if (not registered) {
+      atexit (cleanup);
+      registered = true;
+    }
+    created.push_back (name);
+  }
+
+  // the segments left by pid, once it is killed
+  inline void cleanup_of (pid_t pid) {
+    DIR* dir = opendir ("/dev/shm");
+    if (not dir)
+      return;
+    auto of_pid = prefix (pid);
+    while (auto entry = readdir (dir))
+      if (std::string (entry->d_name).starts_with (of_pid))
+        shm_unlink (("/" + std::string (entry->d_name)).c_str ());
+    closedir (dir);
+  }
+}
+
 // wrapper around a pipe with functions to read/write basic types and bigger structs
+//
+// Writes go to a buffer that flush () sends as one frame: the size of the
+// payload followed by the payload.  Reads are served from the current frame,
+// and the next one is read when it is exhausted, so a value may span frames.
+// Every message must be followed by a flush () before waiting for the other
+// side.
 class pipe_t {
   public:
 
@@ -41,7 +105,12 @@ class pipe_t {
     struct { int r, w; };
     int fd[2];
   };
-  int byte_count = 0;
+  size_t byte_count = 0;
+  bool shared_memory = true; // whether both ends can share memory segments
+
+  private:
+  std::vector<char> wbuf, rbuf;
+  size_t rpos = 0;
 
   public:
   pipe_t () {
@@ -54,29 +123,120 @@ class pipe_t {
   }
 
   // return how many bytes were read/written + reset the counter
-  int get_bytes_count () {
-    int t = byte_count;
+  size_t get_bytes_count () {
+    size_t t = byte_count;
     byte_count = 0;
     return t;
   }
 
+  void write_bytes (const void* data, size_t size) {
+    auto p = static_cast<const char*> (data);
+    wbuf.insert (wbuf.end (), p, p + size);
+  }
+
+  void read_bytes (void* data, size_t size) {
+    auto p = static_cast<char*> (data);
+    while (size > 0) {
+      if (rpos == rbuf.size ())
+        read_frame ();
+      size_t n = std::min (size, rbuf.size () - rpos);
+      std::memcpy (p, rbuf.data () + rpos, n);
+      rpos += n;
+      p += n;
+      size -= n;
+    }
+  }
+
+  // send everything written so far as one frame; frames of at most PIPE_BUF
+  // bytes are written atomically, so several processes can share a pipe for
+  // small messages
+  void flush () {
+    if (wbuf.empty ())
+      return;
+    uint64_t size = wbuf.size ();
+    iovec iov[2] = {{&size, sizeof (size)}, {wbuf.data (), wbuf.size ()}};
+    write_full (iov, 2);
+    byte_count += sizeof (size) + wbuf.size ();
+    wbuf.clear ();
+  }
+
   // write/read any basic type
   template<class T>
   void write_obj (const T& value) {
-    int ret = write (w, &value, sizeof (T));
-    assert(ret > 0);
-    byte_count += ret;
+    write_bytes (&value, sizeof (T));
   }
 
   template<class T>
   T read_obj () {
     T value;
-    int ret = read (r, &value, sizeof (T));
-    assert(ret > 0);
-    byte_count += ret;
+    read_bytes (&value, sizeof (T));
     return value;
   }
 
+  private:
+  // writev until everything is written, resuming in the middle of an iovec
+  // after a partial write
+  void write_full (iovec* iov, int count) {
+    while (count > 0) {
+      ssize_t ret = writev (w, iov, count);
+      if (ret < 0) {
+        if (errno == EINTR)
+          continue;
+        error (2, errno, "cannot write to pipe");
+      }
+      while (count > 0 and size_t (ret) >= iov->iov_len) {
+        ret -= iov->iov_len;
+        ++iov;
+        --count;
+      }
+      if (count > 0) {
+        iov->iov_base = static_cast<char*> (iov->iov_base) + ret;
+        iov->iov_len -= ret;
+      }
+    }
+  }
+
+  void read_full (void* data, size_t size) {
+    auto p = static_cast<char*> (data);
+    while (size > 0) {
+      ssize_t ret = read (r, p, size);
+      if (ret < 0) {
+        if (errno == EINTR)
+          continue;
+        error (2, errno, "cannot read from pipe");
+      }
+      if (ret == 0)
+        error (2, 0, "unexpected end of pipe");
+      p += ret;
+      size -= ret;
+    }
+  }
+
+  void read_frame () {
+    uint64_t size;
+    read_full (&size, sizeof (size));
+    if (size > MAX_FRAME_BYTES)
+      error (2, 0, "frame of %llu bytes is too large", (unsigned long long) size);
+    rbuf.resize (size);
+    read_full (rbuf.data (), size);
+    rpos = 0;
+    byte_count += sizeof (size) + size;
+  }
+
+  // the sizes read from the other side are checked before anything is
+  // allocated for them
+  size_t checked_count (size_t count, size_t size) {
+    if (count > MAX_FRAME_BYTES / std::max (size, size_t (1)))
+      error (2, 0, "corrupted stream: %zu objects of %zu bytes", count, size);
+    return count;
+  }
+
+  size_t read_count (size_t size) {
+    return checked_count (read_obj<size_t> (), size);
+  }
+
+  public:
+
   // write/read guards around structs for debugging purposes
 #ifndef NDEBUG
   void write_guard (int value) {
@@ -104,34 +264,77 @@ class pipe_t {
   void write_string (const std::string& str) {
     write_guard (STRING_START);
     write_obj<size_t> (str.size ());
-    for(char c: str) {
-      write_obj<char> (c);
-    }
+    write_bytes (str.data (), str.size ());
     write_guard (STRING_END);
   }
 
   std::string read_string () {
     read_guard (STRING_START);
-    size_t size = read_obj<size_t> ();
+    size_t size = read_count (1);
     std::string str;
     str.resize (size);
-    for(size_t i = 0; i < size; i++) {
-      str[i] = read_obj<char> ();
-    }
+    read_bytes (str.data (), size);
     read_guard (STRING_END);
     return str;
   }
 
+  // downsets of at least SHM_DOWNSET_THRESHOLD bytes are written to a
+  // shared memory segment, and only its name goes through the pipe; the
+  // reader builds the downset from the mapped segment and unlinks it, see
+  // shm_segments for the segments it never reads.  The
+  // segment holds a shm_downset_header followed by the elements.
+  struct shm_downset_header {
+    int32_t downset_size, element_size;
+  };
+
   void write_downset (GenericDownset& downset) {
     write_guard (DOWNSET_START);
 
-    write_obj<int> (downset.size ()); // number of dominating elements
-    write_obj<int> ((*downset.begin ()).size ()); // number of values per element (= number of states in automaton)
+    int downset_size = downset.size (); // number of dominating elements
+    int element_size = (*downset.begin ()).size (); // number of values per element (= number of states in automaton)
+    size_t bytes = size_t (downset_size) * element_size * sizeof (VECTOR_ELT_T);
+
+    if (shared_memory and SHM_DOWNSET_THRESHOLD > 0 and bytes >= SHM_DOWNSET_THRESHOLD) {
+      static unsigned segment_count = 0;
+      std::string name = "/" + shm_segments::prefix (getpid ()) + std::to_string (segment_count++);
+      size_t segment_size = sizeof (shm_downset_header) + bytes;
+
+      int fd = shm_open (name.c_str (), O_CREAT | O_EXCL | O_RDWR, 0600);
+      if (fd >= 0)
+        shm_segments::add (name);
+      if (fd < 0 or ftruncate (fd, segment_size) != 0)
+        error (2, errno, "cannot create shared memory segment %s", name.c_str ());
+      void* segment = mmap (nullptr, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if (segment == MAP_FAILED)
+        error (2, errno, "cannot map shared memory segment %s", name.c_str ());
+      close (fd);
+
+      *static_cast<shm_downset_header*> (segment) = {downset_size, element_size};
+      auto data = reinterpret_cast<VECTOR_ELT_T*> (static_cast<char*> (segment) + sizeof (shm_downset_header));
+      for(auto& state: downset) {
+        for(auto& value: state) {
+          *data++ = value;
+        }
+      }
+      munmap (segment, segment_size);
 
-    for(auto& state: downset) {
-      for(auto& value: state) {
-        write_obj<VECTOR_ELT_T> (value);
+      write_obj<char> (1);
+      write_string (name);
+    }
+    else {
+      write_obj<char> (0);
+      write_obj<int> (downset_size);
+      write_obj<int> (element_size);
+
+      // the elements go to the buffer as one block
+      std::vector<VECTOR_ELT_T> block;
+      block.reserve (size_t (downset_size) * element_size);
+      for(auto& state: downset) {
+        for(auto& value: state) {
+          block.push_back (value);
+        }
       }
+      write_bytes (block.data (), bytes);
     }
 
     write_guard (DOWNSET_END);
@@ -140,28 +343,60 @@ class pipe_t {
   std::shared_ptr<GenericDownset> read_downset () {
     read_guard (DOWNSET_START);
 
-    int downset_size = read_obj<int> ();
-    int element_size = read_obj<int> ();
-
     std::shared_ptr<GenericDownset> result;
+
+    if (read_obj<char> ()) {
+      std::string name = read_string ();
+      int fd = shm_open (name.c_str (), O_RDONLY, 0);
+      struct stat st;
+      if (fd < 0 or fstat (fd, &st) != 0)
+        error (2, errno, "cannot open shared memory segment %s", name.c_str ());
+      void* segment = mmap (nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+      if (segment == MAP_FAILED)
+        error (2, errno, "cannot map shared memory segment %s", name.c_str ());
+      close (fd);
+      shm_unlink (name.c_str ());
+
+      auto header = *static_cast<const shm_downset_header*> (segment);
+      if (size_t (st.st_size) < sizeof (shm_downset_header)
+          or header.downset_size < 0 or header.element_size < 0
+          or (size_t (st.st_size) - sizeof (shm_downset_header)) / sizeof (VECTOR_ELT_T)
+             / std::max (header.element_size, 1) < size_t (header.downset_size))
+        error (2, 0, "corrupted shared memory segment %s", name.c_str ());
+      auto data = reinterpret_cast<const VECTOR_ELT_T*> (static_cast<const char*> (segment)
+                                                          + sizeof (shm_downset_header));
+      result = build_downset (header.downset_size, header.element_size, data);
+      munmap (segment, st.st_size);
+    }
+    else {
+      int downset_size = read_obj<int> ();
+      int element_size = read_obj<int> ();
+      if (downset_size < 0 or element_size < 0)
+        error (2, 0, "corrupted stream: downset of %d elements of size %d", downset_size, element_size);
+
+      std::vector<VECTOR_ELT_T> block (checked_count (size_t (downset_size) * element_size,
+                                                      sizeof (VECTOR_ELT_T)));
+      read_bytes (block.data (), block.size () * sizeof (VECTOR_ELT_T));
+      result = build_downset (downset_size, element_size, block.data ());
+    }
+
+    read_guard (DOWNSET_END);
+    return result;
+  }
+
+  std::shared_ptr<GenericDownset> build_downset (int downset_size, int element_size,
+                                                 const VECTOR_ELT_T* data) {
     std::vector<GenericDownset::value_type> elements;
+    elements.reserve (downset_size);
 
     for(int j = 0; j < downset_size; j++) {
       auto vec = posets::utils::vector_mm<VECTOR_ELT_T> (element_size, 0);
       for (int i = 0; i < element_size; i++) {
-        vec[i] = read_obj<VECTOR_ELT_T> ();
+        vec[i] = *data++;
       }
-      /*if (result == nullptr) {
-        result = std::make_shared<GenericDownset> (GenericDownset::value_type (vec));
-      }
-      else result->insert (GenericDownset::value_type (vec));
-      */
       elements.push_back (GenericDownset::value_type (vec));
     }
-    result = std::make_shared<GenericDownset> (std::move (elements));
-
-    read_guard (DOWNSET_END);
-    return result;
+    return std::make_shared<GenericDownset> (std::move (elements));
   }
 
   void write_formula (spot::formula f) {
@@ -181,27 +416,101 @@ class pipe_t {
     return spot::parse_formula (str);
   }
 
-  void write_bdd (bdd b, spot::bdd_dict_ptr dict) {
+  // BDDs are sent as one table of nodes shared between all of them: the
+  // variables by AP name, then each node as the indices of its variable and
+  // of its low and high children (0 and 1 are the constants), children
+  // first, and finally the index of each BDD.  Rebuilding is linear in the
+  // number of nodes.
+  void write_bdds (const std::vector<bdd>& bdds, spot::bdd_dict_ptr dict) {
     write_guard (BDD_START);
 
-    // turn the BDD into a formula, write that
-    spot::formula f = spot::bdd_to_formula (b, dict);
-    write_formula (f);
+    std::unordered_map<int, unsigned> node_index {{bddfalse.id (), 0}, {bddtrue.id (), 1}};
+    std::unordered_map<int, unsigned> var_index;
+    std::vector<int> vars;
+    std::vector<std::array<unsigned, 3>> nodes;
+
+    std::function<unsigned (const bdd&)> visit = [&] (const bdd& b) -> unsigned {
+      if (auto it = node_index.find (b.id ()); it != node_index.end ())
+        return it->second;
+      unsigned low = visit (bdd_low (b));
+      unsigned high = visit (bdd_high (b));
+      auto [var, inserted] = var_index.emplace (bdd_var (b), vars.size ());
+      if (inserted)
+        vars.push_back (bdd_var (b));
+      nodes.push_back ({var->second, low, high});
+      return node_index[b.id ()] = nodes.size () + 1;
+    };
+
+    std::vector<unsigned> roots;
+    for (const auto& b : bdds)
+      roots.push_back (visit (b));
+
+    write_obj<size_t> (vars.size ());
+    for (int var : vars)
+      write_string (dict->bdd_map[var].f.ap_name ());
+    write_obj<size_t> (nodes.size ());
+    write_bytes (nodes.data (), nodes.size () * sizeof (nodes[0]));
+    write_obj<size_t> (roots.size ());
+    write_bytes (roots.data (), roots.size () * sizeof (roots[0]));
 
     write_guard (BDD_END);
   }
 
-  bdd read_bdd (spot::bdd_dict_ptr dict) {
+  // the APs are registered for owner if given, otherwise only while reading,
+  // for an owner of their own that does not release the registrations of others
+  std::vector<bdd> read_bdds (spot::bdd_dict_ptr dict, spot::twa_graph_ptr owner = nullptr) {
     read_guard (BDD_START);
+    char reading;
+
+    size_t var_count = read_count (1);
+    std::vector<bdd> vars;
+    for (size_t i = 0; i < var_count; i++) {
+      spot::formula ap = spot::formula::ap (read_string ());
+      int var = owner ? owner->register_ap (ap) : dict->register_proposition (ap, &reading);
+      vars.push_back (bdd_ithvar (var));
+    }
+
+    std::vector<std::array<unsigned, 3>> nodes (read_count (sizeof (std::array<unsigned, 3>)));
+    read_bytes (nodes.data (), nodes.size () * sizeof (nodes[0]));
+
+    // the children of a node come before it in the table
+    std::vector<bdd> built {bddfalse, bddtrue};
+    built.reserve (nodes.size () + 2);
+    for (const auto& [var, low, high] : nodes) {
+      if (var >= vars.size () or low >= built.size () or high >= built.size ())
+        error (2, 0, "corrupted BDD: node %zu refers to a later node or an unknown variable",
+               built.size ());
+      built.push_back (bdd_ite (vars[var], built[high], built[low]));
+    }
+
+    std::vector<unsigned> roots (read_count (sizeof (unsigned)));
+    read_bytes (roots.data (), roots.size () * sizeof (roots[0]));
+    std::vector<bdd> res;
+    res.reserve (roots.size ());
+    for (unsigned root : roots) {
+      if (root >= built.size ())
+        error (2, 0, "corrupted BDD: root %u out of %zu nodes", root, built.size ());
+      res.push_back (built[root]);
+    }
 
-    spot::formula formula = read_formula ();
-    bdd res = spot::formula_to_bdd (formula, dict, this);
-    dict->unregister_all_my_variables (this);
+    if (not owner)
+      dict->unregister_all_my_variables (&reading);
 
     read_guard (BDD_END);
     return res;
   }
 
+  void write_bdd (bdd b, spot::bdd_dict_ptr dict) {
+    write_bdds ({b}, dict);
+  }
+
+  bdd read_bdd (spot::bdd_dict_ptr dict) {
+    auto bdds = read_bdds (dict);
+    if (bdds.size () != 1)
+      error (2, 0, "corrupted stream: %zu BDDs instead of one", bdds.size ());
+    return bdds.front ();
+  }
+
   void write_automaton (spot::twa_graph_ptr aut) {
     write_guard (AUTOMATON_START);
 
@@ -218,15 +527,15 @@ class pipe_t {
       write_obj<char> (acc);
     }
 
-    // write all the edges
-    unsigned edge_count = 0;
+    // write all the edges, with their conditions in one table
+    std::vector<bdd> conds;
     for(auto& edge: aut->edges ()) {
       write_obj<unsigned> (edge.src);
       write_obj<unsigned> (edge.dst);
-      write_bdd (edge.cond, aut->get_dict ());
-      edge_count++;
+      conds.push_back (edge.cond);
     }
-    assert (edge_count == aut->num_edges ());
+    assert (conds.size () == aut->num_edges ());
+    write_bdds (conds, aut->get_dict ());
 
     write_guard (AUTOMATON_END);
   }
@@ -250,14 +559,19 @@ class pipe_t {
       acc[i] = read_obj<char> ();
     }
 
+    std::vector<std::pair<unsigned, unsigned>> src_dst (edges);
+    for(unsigned i = 0; i < edges; i++) {
+      src_dst[i].first = read_obj<unsigned> ();
+      src_dst[i].second = read_obj<unsigned> ();
+    }
+    std::vector<bdd> conds = read_bdds (dict, aut);
+
     for(unsigned i = 0; i < edges; i++) {
-      unsigned src = read_obj<unsigned> ();
-      unsigned dst = read_obj<unsigned> ();
-      bdd cond = read_bdd (dict);
+      auto [src, dst] = src_dst[i];
       if (acc[src]) {
-        aut->new_acc_edge (src, dst, cond);
+        aut->new_acc_edge (src, dst, conds[i]);
       } else {
-        aut->new_edge (src, dst, cond);
+        aut->new_edge (src, dst, conds[i]);
       }
     }
 
@@ -289,6 +603,8 @@ class pipe_t {
 
     // write whether this safe region is exact or not
     write_obj<char> (r.solved);
+    write_obj<unsigned> (r.cluster);
+    write_obj<int> (r.K);
 
     write_guard (SAFETYGAME_END);
   }
@@ -309,6 +625,8 @@ class pipe_t {
     r.safe = has_safe ? std::shared_ptr<GenericDownset> (read_downset ()) : nullptr;
 
     r.solved = read_obj<char> ();
+    r.cluster = read_obj<unsigned> ();
+    r.K = read_obj<int> ();
 
     read_guard (SAFETYGAME_END);
     return r;
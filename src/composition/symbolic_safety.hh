@@ -0,0 +1,224 @@
+#pragma once
+
+#include <deque>
+#include <map>
+#include <vector>
+
+#include <spot/twa/twagraph.hh>
+
+#include "types.hh"
+#include "utils/cancellation.hh"
+
+// Safety conjuncts, such as G (a -> X b) or bounded responses, translate to
+// automata in which an accepting state can always go on to an accepting
+// state: a run that reaches one can stay in them forever, so the controller
+// has to keep every run away from them, and the counters of the other states
+// never grow.  The game is then a plain safety game on the sets of states the
+// runs are in, which is solved here on BDDs, with one variable per state,
+// instead of on antichains.
+//
+// Any strategy for the whole specification keeps the set of this conjunct in
+// its winning sets, so the conjunct can be replaced by exactly that: a
+// deterministic automaton with one state per winning set reachable from the
+// initial one, and a losing sink for the letters that leave them.  This
+// automaton is used when it is the smaller one; its states are boolean but
+// for the sink, so that the merges lose the counters of the conjunct.
+namespace symbolic_safety {
+  inline bool applies (const spot::twa_graph_ptr& aut) {
+    for (unsigned q = 0; q < aut->num_states (); ++q) {
+      if (not aut->state_is_accepting (q))
+        continue;
+      bdd stay = bddfalse;
+      for (auto& e : aut->out (q))
+        if (aut->state_is_accepting (e.dst))
+          stay |= e.cond;
+      if (stay != bddtrue)
+        return false;
+    }
+    return true;
+  }
+
+  namespace detail {
+    inline bool subset (const std::vector<bool>& a, const std::vector<bool>& b) {
+      for (size_t q = 0; q < a.size (); ++q)
+        if (a[q] and not b[q])
+          return false;
+      return true;
+    }
+
+    // the first full assignment of the variables first..first+n-1 in f, taking
+    // each variable when possible
+    inline std::vector<bool> pick (bdd f, int first, unsigned n, bdd& chosen, bdd& below) {
+      std::vector<bool> set (n);
+      chosen = below = bddtrue;
+      for (unsigned q = 0; q < n; ++q)
+        if ((f & chosen & bdd_ithvar (first + q)) != bddfalse) {
+          chosen &= bdd_ithvar (first + q);
+          set[q] = true;
+        }
+        else {
+          chosen &= bdd_nithvar (first + q);
+          below &= bdd_nithvar (first + q);
+        }
+      return set;
+    }
+  }
+
+  // Solves game, as prepared for its K, without invariant, and may replace
+  // its automaton as above; the game is left untouched if its region would
+  // have more than max_size elements, and false is returned.
+  inline bool solve (safety_game& game, bdd all_inputs, bdd all_outputs, size_t max_size) {
+    auto aut = game.aut;
+    unsigned n = aut->num_states ();
+    auto dict = aut->get_dict ();
+    // some run is in state q now, first + q, or after the letter, first + n + q
+    int first = dict->register_anonymous_variables (2 * n, &game);
+    auto in = [&] (unsigned q) { return bdd_ithvar (first + q); };
+    auto cube = [&] (const std::vector<bool>& set) {
+      bdd c = bddtrue;
+      for (unsigned q = 0; q < n; ++q)
+        c &= set[q] ? in (q) : !in (q);
+      return c;
+    };
+
+    // the sets of states after one letter
+    std::vector<bdd> succ (n, bddfalse);
+    for (auto& e : aut->edges ())
+      succ[e.dst] |= in (e.src) & e.cond;
+    bddPair* next = bdd_newpair ();
+    for (unsigned q = 0; q < n; ++q)
+      bdd_setbddpair (next, first + q, succ[q]);
+
+    bdd safe = bddtrue;
+    for (unsigned q = 0; q < n; ++q)
+      if (aut->state_is_accepting (q))
+        safe &= !in (q);
+
+    // greatest fixpoint: whatever the input, some output leads to a safe set
+    try {
+      while (true) {
+        utils::check_cancelled ();
+        bdd pre = safe & bdd_forall (bdd_exist (bdd_veccompose (safe, next), all_outputs), all_inputs);
+        if (pre == safe)
+          break;
+        safe = pre;
+      }
+    } catch (const utils::cancelled&) {
+      bdd_freepair (next);
+      dict->unregister_all_my_variables (&game);
+      throw;
+    }
+    bdd_freepair (next);
+
+    std::vector<bool> init (n);
+    init[aut->get_init_state_number ()] = true;
+
+    // safe is closed under subsets; taking every state that can still be
+    // taken gives a maximal set, which is then removed with its subsets
+    bool done = true;
+    std::vector<std::vector<bool>> maximal;
+    bdd winning = safe;
+    if ((safe & cube (init)) != bddfalse)
+      while (safe != bddfalse) {
+        if (maximal.size () == max_size) {
+          done = false;
+          break;
+        }
+        bdd chosen, below;
+        maximal.push_back (detail::pick (safe, first, n, chosen, below));
+        safe &= !below;
+      }
+
+    // the deterministic automaton, given up once it is no smaller
+    std::vector<std::vector<bool>> sets {{}}; // the set of each state, none for the sink
+    spot::twa_graph_ptr det = nullptr;
+    if (done and not maximal.empty ()) {
+      det = new_automaton (dict);
+      det->copy_ap_of (aut);
+      det->new_state ();
+      det->new_acc_edge (0, 0, bddtrue);
+
+      bdd all_next = bddtrue;
+      for (unsigned q = 0; q < n; ++q)
+        all_next &= bdd_ithvar (first + n + q);
+
+      std::map<std::vector<bool>, unsigned> index;
+      std::deque<unsigned> todo;
+      auto state_of = [&] (const std::vector<bool>& set) {
+        auto [it, inserted] = index.emplace (set, det->num_states ());
+        if (inserted) {
+          det->new_state ();
+          sets.push_back (set);
+          todo.push_back (it->second);
+        }
+        return it->second;
+      };
+      det->set_init_state (state_of (init));
+
+      while (not todo.empty () and det->num_states () < n) {
+        unsigned s = todo.front ();
+        todo.pop_front ();
+        bdd at = cube (sets[s]);
+        // the letters, with the set they lead to
+        bdd rel = bddtrue;
+        for (unsigned q = 0; q < n; ++q)
+          rel &= bdd_biimp (bdd_ithvar (first + n + q), bdd_restrict (succ[q], at));
+        bdd targets = bdd_exist (rel, all_inputs & all_outputs), lose = bddfalse;
+        while (targets != bddfalse) {
+          bdd chosen, below;
+          auto set = detail::pick (targets, first + n, n, chosen, below);
+          targets &= !chosen;
+          bdd cond = bdd_exist (rel & chosen, all_next);
+          if ((winning & cube (set)) != bddfalse)
+            det->new_edge (s, state_of (set), cond);
+          else
+            lose |= cond;
+        }
+        if (lose != bddfalse)
+          det->new_edge (s, 0, lose);
+      }
+      if (not todo.empty () or det->num_states () >= n)
+        det = nullptr;
+    }
+    dict->unregister_all_my_variables (&game);
+
+    if (not done) {
+      verb_do (1, vout << "Safety region has more than " << max_size << " elements, leaving it to the solver\n");
+      return false;
+    }
+
+    game.solved = true;
+    game.invariant = bddtrue;
+    if (maximal.empty ()) {
+      game.safe = nullptr;
+      return true;
+    }
+
+    // a set of states of det is safe iff the union of their sets is
+    std::vector<GenericDownset::value_type> elements;
+    for (const auto& m : maximal) {
+      if (det) {
+        auto vec = posets::utils::vector_mm<VECTOR_ELT_T> (det->num_states (), -1);
+        for (unsigned s = 1; s < det->num_states (); ++s)
+          if (detail::subset (sets[s], m))
+            vec[s] = 0;
+        elements.push_back (GenericDownset::value_type (vec));
+      }
+      else {
+        auto vec = posets::utils::vector_mm<VECTOR_ELT_T> (n, -1);
+        for (unsigned q = 0; q < n; ++q)
+          if (m[q])
+            vec[q] = (q < game.bool_threshold) ? game.K - 1 : 0;
+        elements.push_back (GenericDownset::value_type (vec));
+      }
+    }
+    if (det) {
+      verb_do (1, vout << "Safety conjunct replaced by its " << det->num_states ()
+               /*   */ << " winning sets, from " << n << " states\n");
+      game.aut = det;
+      game.bool_threshold = 1;
+    }
+    game.safe = std::make_shared<GenericDownset> (std::move (elements));
+    return true;
+  }
+}
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "../configuration.hh"
+#include "../error_msg.hh"
+
+// Stream sockets between the coordinator and remote workers.  An address is
+// either unix:PATH for a Unix socket, or HOST:PORT for TCP, with an empty
+// host to listen on every interface.  A socket is used for both directions,
+// so it can serve as both ends of the pipe_t of a worker.
+//
+// Objects go through the sockets as they are in memory, so both ends must be
+// the same build, with the same word size and byte order; handshake checks
+// this before anything else is sent.
+namespace transport {
+  // bumped whenever the messages between the coordinator and the workers change
+  constexpr uint16_t protocol_version = 1;
+
+  namespace detail {
+    inline bool is_unix (const std::string& addr) {
+      return addr.starts_with ("unix:");
+    }
+
+    inline sockaddr_un unix_address (const std::string& addr) {
+      sockaddr_un sa {};
+      sa.sun_family = AF_UNIX;
+      auto path = addr.substr (5);
+      if (path.size () >= sizeof (sa.sun_path))
+        error (2, 0, "socket path too long: %s", path.c_str ());
+      std::strcpy (sa.sun_path, path.c_str ());
+      return sa;
+    }
+
+    inline addrinfo* tcp_addresses (const std::string& addr, bool passive) {
+      auto colon = addr.rfind (':');
+      if (colon == std::string::npos)
+        error (2, 0, "bad address, expected HOST:PORT or unix:PATH: %s", addr.c_str ());
+      auto host = addr.substr (0, colon), port = addr.substr (colon + 1);
+
+      addrinfo hints {};
+      hints.ai_family = AF_UNSPEC;
+      hints.ai_socktype = SOCK_STREAM;
+      hints.ai_flags = passive ? AI_PASSIVE : 0;
+      addrinfo* res;
+      int ret = getaddrinfo (host.empty () ? nullptr : host.c_str (), port.c_str (), &hints, &res);
+      if (ret != 0)
+        error (2, 0, "cannot resolve %s: %s", addr.c_str (), gai_strerror (ret));
+      return res;
+    }
+
+    // messages are small and answered, don't let Nagle delay them; this
+    // fails harmlessly on Unix sockets
+    inline void no_delay (int fd) {
+      int one = 1;
+      setsockopt (fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof (one));
+    }
+
+    inline void receive_timeout (int fd, int seconds) {
+      timeval tv {seconds, 0};
+      setsockopt (fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof (tv));
+    }
+
+    // the hello of this build: a magic, the protocol version in little
+    // endian, then what the layout of the messages depends on
+    using hello_t = std::array<uint8_t, 16>;
+
+    inline hello_t hello () {
+      hello_t h {'A', 'C', 'A', 'C', 'I', 'A', 'B', 'S',
+                 uint8_t (protocol_version & 0xff), uint8_t (protocol_version >> 8),
+#ifndef NDEBUG
+                 1, // the messages have guards
+#else
+                 0,
+#endif
+                 sizeof (size_t), sizeof (unsigned), sizeof (VECTOR_ELT_T),
+                 std::endian::native == std::endian::little ? uint8_t (1) : uint8_t (2),
+                 0};
+      return h;
+    }
+  }
+
+  // exchange hellos with the other end of fd, and fail unless it is the same
+  // build; a peer that says nothing for a while is given up on
+  inline void handshake (int fd, const std::string& peer) {
+    auto mine = detail::hello (), theirs = detail::hello_t {};
+
+    for (size_t done = 0; done < mine.size (); ) {
+      ssize_t ret = write (fd, mine.data () + done, mine.size () - done);
+      if (ret < 0 and errno != EINTR)
+        error (2, errno, "cannot greet %s", peer.c_str ());
+      done += std::max (ret, ssize_t (0));
+    }
+
+    detail::receive_timeout (fd, 30);
+    for (size_t done = 0; done < theirs.size (); ) {
+      ssize_t ret = read (fd, theirs.data () + done, theirs.size () - done);
+      if (ret == 0)
+        error (2, 0, "%s closed the connection during the handshake", peer.c_str ());
+      if (ret < 0 and errno != EINTR)
+        error (2, errno, "no handshake from %s", peer.c_str ());
+      done += std::max (ret, ssize_t (0));
+    }
+    detail::receive_timeout (fd, 0);
+
+    if (std::memcmp (theirs.data (), mine.data (), 8) != 0)
+      error (2, 0, "%s is not an acacia-bonsai peer", peer.c_str ());
+    unsigned version = theirs[8] | (theirs[9] << 8);
+    if (version != protocol_version)
+      error (2, 0, "%s speaks protocol %u, expected %u", peer.c_str (), version, protocol_version);
+    if (theirs != mine)
+      error (2, 0, "%s is a different build (guards %d, size_t %d, unsigned %d, "
+             "vector elements %d, byte order %d; here %d, %d, %d, %d, %d)", peer.c_str (),
+             theirs[10], theirs[11], theirs[12], theirs[13], theirs[14],
+             mine[10], mine[11], mine[12], mine[13], mine[14]);
+  }
+
+  inline bool is_local (const std::string& addr) {
+    return detail::is_unix (addr);
+  }
+
+  inline int listen_on (const std::string& addr) {
+    int fd = -1;
+    if (detail::is_unix (addr)) {
+      auto sa = detail::unix_address (addr);
+      unlink (sa.sun_path);
+      fd = socket (AF_UNIX, SOCK_STREAM, 0);
+      if (fd < 0 or bind (fd, reinterpret_cast<sockaddr*> (&sa), sizeof (sa)) != 0)
+        error (2, errno, "cannot bind to %s", addr.c_str ());
+    }
+    else {
+      auto res = detail::tcp_addresses (addr, true);
+      for (auto ai = res; ai; ai = ai->ai_next) {
+        fd = socket (ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0)
+          continue;
+        int one = 1;
+        setsockopt (fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof (one));
+        if (bind (fd, ai->ai_addr, ai->ai_addrlen) == 0)
+          break;
+        close (fd);
+        fd = -1;
+      }
+      freeaddrinfo (res);
+      if (fd < 0)
+        error (2, errno, "cannot bind to %s", addr.c_str ());
+    }
+
+    if (listen (fd, SOMAXCONN) != 0)
+      error (2, errno, "cannot listen on %s", addr.c_str ());
+    return fd;
+  }
+
+  inline int accept_from (int listen_fd) {
+    int fd;
+    do
+      fd = accept (listen_fd, nullptr, nullptr);
+    while (fd < 0 and errno == EINTR);
+    if (fd < 0)
+      error (2, errno, "cannot accept a worker");
+    detail::no_delay (fd);
+    return fd;
+  }
+
+  // connect to addr, retrying for a while so that workers may be started
+  // before the coordinator listens
+  inline int connect_to (const std::string& addr, int attempts = 300) {
+    for (int i = 0; i < attempts; ++i) {
+      if (detail::is_unix (addr)) {
+        auto sa = detail::unix_address (addr);
+        int fd = socket (AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+          error (2, errno, "cannot create socket");
+        if (connect (fd, reinterpret_cast<sockaddr*> (&sa), sizeof (sa)) == 0)
+          return fd;
+        close (fd);
+      }
+      else {
+        auto res = detail::tcp_addresses (addr, false);
+        for (auto ai = res; ai; ai = ai->ai_next) {
+          int fd = socket (ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+          if (fd < 0)
+            continue;
+          if (connect (fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            freeaddrinfo (res);
+            detail::no_delay (fd);
+            return fd;
+          }
+          close (fd);
+        }
+        freeaddrinfo (res);
+      }
+      std::this_thread::sleep_for (std::chrono::milliseconds (100));
+    }
+    error (2, errno, "cannot connect to %s", addr.c_str ());
+    return -1;
+  }
+}
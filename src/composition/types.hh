@@ -4,6 +4,7 @@
 #include <posets/vectors.hh>
 #include <posets/downsets.hh>
 #include "../utils/verbose.hh"
+#include "../utils/static_switch.hh"
 #include <spot/misc/bddlt.hh>
 #include <spot/misc/escape.hh>
 #include <spot/misc/timer.hh>
@@ -12,6 +13,14 @@
 #include <spot/twa/bddprint.hh>
 #include <optional>
 
+// the capacities of the array part of the vectors, which are the only sizes
+// the solver is dispatched on, see static_tier_switch_t
+struct array_capacity {
+  constexpr size_t operator () (size_t n) const {
+    return posets::vectors::traits<posets::vectors::ARRAY_IMPL, VECTOR_ELT_T>::capacity_for (n);
+  }
+};
+
 // downset type that does not depend on the exact automaton
 using GenericDownset = posets::downsets::VECTOR_AND_BITSET_DOWNSET_IMPL<posets::vectors::vector_backed<VECTOR_ELT_T>>;
 
@@ -25,6 +34,28 @@ struct safety_game {
   std::shared_ptr<GenericDownset> safe;
   bool solved = false;
   bdd invariant = bddtrue;
+  unsigned cluster = 0; // games are only merged within a cluster, see clustering.hh
+  int K = 0; // the K of the safe region
+
+  // bring the safe region to a larger K, the way the solver does when it
+  // increments K: the nonboolean states get the extra budget, the boolean
+  // ones are reset to 0, and the result is only an overapproximation
+  void rescale (int newK) {
+    assert (newK >= K);
+    if (newK == K)
+      return;
+    int inc = newK - K;
+    K = newK;
+    if (not safe)
+      return;
+    safe = std::make_shared<GenericDownset> (safe->apply ([&] (const auto& s) {
+      auto vec = posets::utils::vector_mm<VECTOR_ELT_T> (s.size (), 0);
+      for (size_t i = 0; i < bool_threshold; ++i)
+        vec[i] = s[i] + inc;
+      return GenericDownset::value_type (vec);
+    }));
+    solved = false;
+  }
 
   auto set_globals () {
     // set the global variables needed for boolean states to function correctly
@@ -44,10 +75,12 @@ struct safety_game {
     constexpr auto STATIC_ARRAY_CAP_MAX =
       posets::vectors::traits<posets::vectors::ARRAY_IMPL, VECTOR_ELT_T>::capacity_for (STATIC_ARRAY_MAX);
 
-    // Maximize usage of the nonbool implementation
+    // Maximize usage of the nonbool implementation; the array capacity is
+    // padded up to the next tier the solver is specialized for.
     auto nonbools = aut->num_states () - nbitsetbools;
     size_t actual_nonbools = (nonbools <= STATIC_ARRAY_CAP_MAX) ?
-    posets::vectors::traits<posets::vectors::ARRAY_IMPL, VECTOR_ELT_T>::capacity_for (nonbools) :
+    static_tier_switch_t<STATIC_ARRAY_TIERS, STATIC_ARRAY_CAP_MAX, array_capacity>::tier_for (
+      posets::vectors::traits<posets::vectors::ARRAY_IMPL, VECTOR_ELT_T>::capacity_for (nonbools)) :
     posets::vectors::traits<posets::vectors::VECTOR_IMPL, VECTOR_ELT_T>::capacity_for (nonbools);
     if (actual_nonbools >= aut->num_states ())
       nbitsetbools = 0;
@@ -109,11 +142,15 @@ enum unreal_x_t {
 enum job_type {
   j_solve,
   j_formula,
+  j_merge,
+  j_seed,
+  j_cancel,
   j_done
 };
 
 enum result_type {
   r_game,
   r_invariant,
-  r_null
+  r_null,
+  r_cancelled
 };
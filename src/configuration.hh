@@ -43,6 +43,68 @@
 # endif
 #endif
 
+// Which array capacities the solver is specialized for: static_tiers::exact
+// instantiates it for every capacity up to STATIC_ARRAY_MAX; static_tiers::pow2
+// and static_tiers::list<...> only for a few, padding the vectors up to the
+// next tier.  Listed tiers must be array capacities, as given by capacity_for,
+// which is checked at compile time; with char elements, multiples of 64 are.
+#ifndef STATIC_ARRAY_TIERS
+# define STATIC_ARRAY_TIERS static_tiers::exact
+#endif
+
+// Whether the actions are computed only over the APs that appear in the
+// automaton, and over one valuation per orbit of its AP symmetries.  Only
+// used by IOS precomputers that support invariants.
+#ifndef AP_REDUCTION
+# define AP_REDUCTION false
+#endif
+
+// Safe regions of at least that many bytes are passed between composition
+// workers through shared memory instead of pipes; 0 to never do so.
+#ifndef SHM_DOWNSET_THRESHOLD
+# define SHM_DOWNSET_THRESHOLD (1ul << 20)
+#endif
+
+// Largest frame, and largest object, that is read from a pipe or a remote
+// worker; anything larger is taken as a corrupted stream.
+#ifndef MAX_FRAME_BYTES
+# define MAX_FRAME_BYTES (1ul << 32)
+#endif
+
+// How composition picks the next two components to merge, see
+// composition/merge_scheduler.hh.
+#ifndef MERGE_SCHEDULER
+# define MERGE_SCHEDULER merge_schedulers::cheapest_pair
+#endif
+
+// Whether composition reduces each merged automaton by direct simulation,
+// see composition/composition.hh.
+#ifndef MERGE_REDUCTION
+# define MERGE_REDUCTION false
+#endif
+
+// When workers are idle and no job is left, composition starts a copy of a
+// solve or merge job that has run this many times longer than the mean of
+// the finished jobs of its kind, with another seed for the input picker; the
+// first copy to finish wins.  0 disables the copies, as does an input picker
+// that does not use the seed.
+#ifndef STRAGGLER_FACTOR
+# define STRAGGLER_FACTOR 4
+#endif
+
+// How long, in milliseconds, composition waits for the running jobs to stop
+// once the answer is known, before it kills their workers.
+#ifndef CANCEL_GRACE
+# define CANCEL_GRACE 200
+#endif
+
+// Composition solves the safety conjuncts on BDDs as soon as they are
+// translated, see composition/symbolic_safety.hh, if their safe region has at
+// most this many elements.  0 disables it.
+#ifndef SYMBOLIC_SAFETY
+# define SYMBOLIC_SAFETY 4096
+#endif
+
 #ifndef CPRE_AVOID_UNIONS
 # define CPRE_AVOID_UNIONS 0
 #endif
@@ -3,6 +3,7 @@
 #include <random>
 #include <optional>
 #include "actioners.hh"
+#include "utils/cancellation.hh"
 
 namespace input_pickers {
   namespace detail {
@@ -30,6 +31,7 @@ namespace input_pickers {
           auto critical_input = Cbar.end ();
 
           for (const auto& f : F) {
+            utils::check_cancelled ();
             bool is_witness = false;
             verb_do (3, vout << "Searching for witness of one-step-loss for " << f << std::endl);
 
@@ -85,6 +87,9 @@ namespace input_pickers {
   }
 
   struct critical {
+      // the inputs are always tried in the same order
+      static constexpr bool uses_seed = false;
+
       template <typename FwdActions, typename Actioner>
       static auto make (FwdActions& fwd_actions, Actioner& actioner) {
         return detail::critical (fwd_actions, actioner);
@@ -3,6 +3,8 @@
 #include <random>
 #include <optional>
 #include "actioners.hh"
+#include "utils/cancellation.hh"
+#include "input_pickers/seed.hh"
 
 namespace input_pickers {
   namespace detail {
@@ -10,7 +12,7 @@ namespace input_pickers {
     struct critical_fullrnd {
       public:
         critical_fullrnd (FwdActions& fwd_actions, Actioner& actioner) :
-          fwd_actions {fwd_actions}, actioner {actioner}, gen {0} {}
+          fwd_actions {fwd_actions}, actioner {actioner}, gen {seed} {}
 
         template <typename SetOfStates>
         auto operator() (const SetOfStates& F) {
@@ -32,6 +34,7 @@ namespace input_pickers {
           auto critical_input = Cbar.end ();
 
           for (const auto& f : F) {
+            utils::check_cancelled ();
             bool is_witness = false;
             verb_do (3, vout << "Searching for witness of one-step-loss for " << f << std::endl);
 
@@ -88,6 +91,9 @@ namespace input_pickers {
   }
 
   struct critical_fullrnd {
+      // the inputs are shuffled with input_pickers::seed
+      static constexpr bool uses_seed = true;
+
       template <typename FwdActions, typename Actioner>
       static auto make (FwdActions& fwd_actions, Actioner& actioner) {
         return detail::critical_fullrnd (fwd_actions, actioner);
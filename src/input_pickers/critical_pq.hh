@@ -1,8 +1,12 @@
 #pragma once
 
+#include <algorithm>
 #include <random>
 #include <optional>
+#include <vector>
 #include "actioners.hh"
+#include "utils/cancellation.hh"
+#include "input_pickers/seed.hh"
 
 namespace input_pickers {
   namespace detail {
@@ -10,10 +14,14 @@ namespace input_pickers {
     struct critical_pq {
       public:
         critical_pq (FwdActions& fwd_actions, Actioner& actioner) :
-          actioner {actioner}, gen {0} {
+          actioner {actioner}, gen {seed} {
+          std::vector<input_and_actions_ref> V (fwd_actions.begin (), fwd_actions.end ());
+          // a seed starts from another order of the inputs
+          if (seed != 0)
+            std::shuffle (V.begin (), V.end (), gen);
           int priority = 0;
-          for (auto& el : fwd_actions)
-            fwd_actions_pq.emplace (priority++, std::ref (el));
+          for (auto& el : V)
+            fwd_actions_pq.emplace (priority++, el);
         }
 
         template <typename SetOfStates>
@@ -28,6 +36,7 @@ namespace input_pickers {
           auto critical_input = fwd_actions_pq.end ();
 
           for (const auto& f : F) {
+            utils::check_cancelled ();
             bool is_witness = false;
             verb_do (3, vout << "Searching for witness of one-step-loss for " << f << std::endl);
 
@@ -92,6 +101,9 @@ namespace input_pickers {
   }
 
   struct critical_pq {
+      // the initial order of the inputs depends on input_pickers::seed
+      static constexpr bool uses_seed = true;
+
       template <typename FwdActions, typename Actioner>
       static auto make (FwdActions& fwd_actions, Actioner& actioner) {
         return detail::critical_pq (fwd_actions, actioner);
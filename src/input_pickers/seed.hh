@@ -0,0 +1,9 @@
+#pragma once
+
+namespace input_pickers {
+  // Seed of the random choices of the input pickers.  0 keeps their usual
+  // order; composition_mt gives other seeds to the copies it starts of a
+  // straggling job, so that the copies explore the inputs differently.  The
+  // input pickers say whether they use it with their uses_seed member.
+  inline unsigned seed = 0;
+}
@@ -6,22 +6,25 @@ namespace ios_precomputers {
     class standard_container {
       public:
         standard_container (Aut aut,
-                            bdd input_support, bdd output_support, bdd invariant) :
-          aut {aut}, input_support {input_support}, output_support {output_support}, invariant {invariant}
+                            bdd input_support, bdd output_support, bdd invariant,
+                            bdd input_restriction) :
+          aut {aut}, input_support {input_support}, output_support {output_support}, invariant {invariant},
+          input_restriction {input_restriction}
         { }
 
       private:
         Aut aut;
         bdd input_support, output_support;
         bdd invariant;
+        bdd input_restriction; // only the inputs in this set are enumerated
 
         class bdd_it {
           public:
             using iterator_category = std::input_iterator_tag;
             using value_type = bdd;
 
-            bdd_it (bdd support) :
-              letter_set {bddtrue},
+            bdd_it (bdd support, bdd letters = bddtrue) :
+              letter_set {letters},
               support {support}
             { get_next_letter (); }
 
@@ -150,8 +153,9 @@ namespace ios_precomputers {
             using iterator_category = std::input_iterator_tag;
             using value_type = std::pair<bdd, ios>;
 
-            in_it (bdd input_support, bdd output_support, Aut aut, bdd _invariant) :
-              bdd_it (input_support),
+            in_it (bdd input_support, bdd output_support, Aut aut, bdd _invariant,
+                   bdd input_restriction = bddtrue) :
+              bdd_it (input_support, input_restriction),
               current_ios (bdd_it::current_letter, ios (bdd_it::current_letter, output_support, aut, _invariant)),
               output_support {output_support}, aut {aut}, invariant {_invariant}
             { }
@@ -171,7 +175,7 @@ namespace ios_precomputers {
         };
 
       public:
-        in_it begin () const { return in_it (input_support, output_support, aut, invariant); }
+        in_it begin () const { return in_it (input_support, output_support, aut, invariant, input_restriction); }
         in_it end () const { return in_it (bddfalse, bddfalse, aut, invariant); }
     };
   }
@@ -181,9 +185,11 @@ namespace ios_precomputers {
 
       template <typename Aut, typename TransSet = std::vector<std::pair<int, int>>>
       static auto make (Aut aut,
-                        bdd input_support, bdd output_support, bdd invariant) {
+                        bdd input_support, bdd output_support, bdd invariant,
+                        bdd input_restriction = bddtrue) {
         return [&] () {
-          return detail::standard_container<Aut, TransSet> (aut, input_support, output_support, invariant);
+          return detail::standard_container<Aut, TransSet> (aut, input_support, output_support, invariant,
+                                                            input_restriction);
         };
       }
   };
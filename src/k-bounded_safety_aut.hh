@@ -15,6 +15,7 @@
 #include <spot/twa/twagraph.hh>
 
 #include "utils/bdd_helper.hh"
+#include "utils/cancellation.hh"
 #include "utils/lambda_ptr.hh"
 #include "utils/ref_ptr_cmp.hh"
 #include <utils/verbose.hh>
@@ -23,6 +24,7 @@
 #include <posets/utils/vector_mm.hh>
 #include <posets/vectors.hh>
 
+#include "aut_preprocessors/ap_reduction.hh"
 #include "ios_precomputers.hh"
 #include "input_pickers.hh"
 #include "actioners.hh"
@@ -49,7 +51,7 @@ class k_bounded_safety_aut_detail {
                                  const IOsPrecomputationMaker& ios_precomputer_maker,
                                  const ActionerMaker& actioner_maker,
                                  const InputPickerMaker& input_picker_maker) :
-      aut {aut}, Kfrom {Kfrom}, Kto {Kto}, Kinc {Kinc},
+      aut {aut}, Kfrom {Kfrom}, Kto {Kto}, Kinc {Kinc}, K {Kfrom},
       input_support {input_support}, output_support {output_support},
       gen {0},
       ios_precomputer_maker {ios_precomputer_maker},
@@ -65,15 +67,27 @@ class k_bounded_safety_aut_detail {
       // call the right constructor: with an extra variant if supported, otherwise the invariant is ignored
       // (it is assumed that other code will see that the invariant was not taken into account,
       //  such as in composition_mt.hh which calls finish_invariant only when needed)
-      if constexpr (IOsPrecomputationMaker::supports_invariant) {
+      if constexpr (IOsPrecomputationMaker::supports_invariant and AP_REDUCTION) {
+        // only enumerate the used APs, and one letter per orbit of their
+        // symmetries; the output part goes through the invariant
+        auto red = aut_preprocessors::ap_reduction (aut, invariant, input_support, output_support);
+        return (ios_precomputer_maker.make (aut, red.input_support, red.output_support,
+                                            invariant & red.output_restriction,
+                                            red.input_restriction)) ();
+      } else if constexpr (IOsPrecomputationMaker::supports_invariant) {
         return (ios_precomputer_maker.make (aut, input_support, output_support, invariant)) ();
       } else {
         return (ios_precomputer_maker.make (aut, input_support, output_support)) ();
       }
     }
 
+    // the K the last call to solve stopped at
+    int current_K () const {
+      return K;
+    }
+
     std::optional<SetOfStates> solve (SetOfStates& F, bdd invariant, std::vector<int> init_state) {
-      int K = Kfrom;
+      K = Kfrom;
 
       // Precompute the input and output actions.
       verb_do (1, vout << "IOS Precomputer with invariant " << bdd_to_formula (invariant) << "..." << std::endl);
@@ -101,6 +115,7 @@ class k_bounded_safety_aut_detail {
       auto input_picker = input_picker_maker.make (input_output_fwd_actions, actioner);
 
       do {
+        utils::check_cancelled ();
         loopcount++;
         verb_do (1, vout << "Loop# " << loopcount << ", F of size " << F.size () << std::endl);
 
@@ -145,6 +160,7 @@ class k_bounded_safety_aut_detail {
   private:
     spot::twa_graph_ptr aut;
     const int Kfrom, Kto, Kinc;
+    int K;
     bdd input_support, output_support;
     std::mt19937 gen;
     const IOsPrecomputationMaker& ios_precomputer_maker;
@@ -509,6 +525,13 @@ class k_bounded_safety_aut_detail {
     }
 
     void synthesis(SetOfStates& F, const std::string& synth_fname, bdd invariant, std::vector<int> init_state) {
+      synthesis_circuit (F, invariant, init_state).save (synth_fname);
+      verb_do (1, vout << "\n\n");
+    }
+
+    // the controller as a circuit, whose latches encode the reachable
+    // elements of F
+    aiger synthesis_circuit(SetOfStates& F, bdd invariant, std::vector<int> init_state) {
       auto inputs_to_ios = ios_precomputers::standard::make (aut, input_support, output_support, invariant) ();
       auto maker = actioners::standard<typename SetOfStates::value_type> ();
       // manually list the two template types so we can set the third (include IOs) to true
@@ -819,17 +842,7 @@ class k_bounded_safety_aut_detail {
                 << '\n';
 #endif
 
-
-      if (synth_fname != "-") {
-        std::ofstream f (synth_fname);
-        aig.output (f, false);
-        f.close ();
-      } else {
-        utils::vout << "\n\n\n";
-        aig.output (utils::vout, true);
-      }
-
-      verb_do (1, vout << "\n\n");
+      return aig;
     }
 
   private:
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <numeric>
 #include <vector>
 #include <string>
 
@@ -9,6 +11,8 @@
 // #include "common_file.hh"
 #include "common_finput.hh" // OK
 // #include "common_sys.hh"
+#include "composition/clustering.hh"
+#include "composition/decompose.hh"
 #include "composition/composition_mt.hh"
 
 
@@ -29,6 +33,12 @@ class ltl_processor final : public job_processor {
     unsigned opt_Kmin_;
     unsigned opt_Kinc_;
     std::vector<int> init_state_;
+    bool decompose_;
+    size_t mem_budget_;
+    std::string listen_addr_;
+    int remote_workers_;
+    bool warm_pool_;
+    bool time_sliced_;
 
 
   public:
@@ -45,13 +55,36 @@ class ltl_processor final : public job_processor {
                    unsigned opt_K_,
                    unsigned opt_Kmin_,
                    unsigned opt_Kinc_,
-                   std::vector<int> init_state_)
+                   std::vector<int> init_state_,
+                   bool decompose_ = false,
+                   size_t mem_budget_ = 0,
+                   std::string listen_addr_ = "",
+                   int remote_workers_ = 0,
+                   bool warm_pool_ = false,
+                   bool time_sliced_ = false)
       : trans_ (trans), input_aps_ (input_aps_), output_aps_ (output_aps_), dict (dict_),
         synth_fname_(synth_fname_), winreg_fname_(winreg_fname_), check_real_(check_real_),
         opt_unreal_x_(opt_unreal_x_), workers_(workers_), opt_K_(opt_K_), opt_Kmin_(opt_Kmin_),
-        opt_Kinc_(opt_Kinc_), init_state_(init_state_)
+        opt_Kinc_(opt_Kinc_), init_state_(init_state_), decompose_(decompose_),
+        mem_budget_(mem_budget_), listen_addr_(listen_addr_), remote_workers_(remote_workers_),
+        warm_pool_(warm_pool_), time_sliced_(time_sliced_)
     {}
 
+    // the check is chosen per process, after the processor is built
+    void set_check (bool check_real, unreal_x_t opt_unreal_x) {
+      check_real_ = check_real;
+      opt_unreal_x_ = opt_unreal_x;
+      if (not check_real_) {
+        // no synthesis for the environment
+        synth_fname_ = "";
+        winreg_fname_ = "";
+      }
+    }
+
+    void drop_remote_workers () {
+      remote_workers_ = 0;
+    }
+
     int process_formula (spot::formula f, const char *, int) override {
       formulas.push_back (f);
       return 0;
@@ -66,6 +99,16 @@ class ltl_processor final : public job_processor {
         return 0;
       }
 
+      // split the formulas into conjuncts, if composition can handle them
+      if (decompose_ and init_state_.empty ()) {
+        std::vector<spot::formula> parts;
+        for (auto& f : formulas)
+          decompose (f, parts);
+        verb_do (1, vout << "Decomposed " << formulas.size () << " formulas into "
+                 /*   */ << parts.size () << " parts\n");
+        formulas = std::move (parts);
+      }
+
       // manually register inputs/outputs
       bdd all_inputs = bddtrue;
       bdd all_outputs = bddtrue;
@@ -89,25 +132,45 @@ class ltl_processor final : public job_processor {
 
       // NOTE: Everything after this point plays a role
       // ONLY if there is MORE THAN ONE LTL formula
-      // TODO: purge everything after this.
-      if (!check_real_) {
-        utils::vout << "Error: can't do composition for unrealizability!\n";
-        return 0;
-      }
-
       if (init_state_.size () > 0) {
         utils::vout << "Error: can't do composition with given initial state!\n";
         return 0;
       }
 
-      if (opt_Kinc_ != 0) {
-        utils::vout << "Error: can't do composition with incrementing K values!\n";
-        return 0;
-      }
+      // formulas that share outputs are merged together first, and clusters
+      // with disjoint outputs are solved independently
+      auto clusters = cluster_by_outputs (formulas, output_aps_);
+      std::vector<size_t> order (formulas.size ());
+      std::iota (order.begin (), order.end (), 0);
+      std::stable_sort (order.begin (), order.end (),
+                        [&] (size_t i, size_t j) { return clusters[i] < clusters[j]; });
+      verb_do (1, vout << formulas.size () << " formulas in "
+               /*   */ << (clusters.empty () ? 0 : *std::max_element (clusters.begin (), clusters.end ()) + 1)
+               /*   */ << " clusters\n");
 
-      for(spot::formula& f: formulas) {
-        composer.add_formula (f);
+      if (!check_real_) {
+        // the environment has to win the conjunction of some cluster: its
+        // formulas are translated together, into one game per cluster
+        std::vector<std::vector<spot::formula>> conjuncts;
+        for (size_t i: order) {
+          conjuncts.resize (clusters[i] + 1);
+          conjuncts[clusters[i]].push_back (formulas[i]);
+        }
+        if (conjuncts.size () == 1)
+          return composer.run_one (spot::formula::And (conjuncts[0]), synth_fname_, winreg_fname_,
+                                   check_real_, opt_unreal_x_);
+        composer.set_check (check_real_, opt_unreal_x_);
+        for (size_t c = 0; c < conjuncts.size (); ++c)
+          composer.add_formula (spot::formula::And (conjuncts[c]), c);
       }
+      else for(size_t i: order) {
+        composer.add_formula (formulas[i], clusters[i]);
+      }
+
+      composer.set_mem_budget (mem_budget_ << 20);
+      composer.set_remote_workers (listen_addr_, remote_workers_);
+      composer.set_warm_up (warm_pool_);
+      composer.set_straggler_copies (not time_sliced_);
 
       return composer.run (workers_, synth_fname_, winreg_fname_);
     }
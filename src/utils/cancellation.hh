@@ -0,0 +1,46 @@
+#pragma once
+
+#include <poll.h>
+#include <csignal>
+#include <exception>
+
+namespace utils {
+  // Cooperative cancellation of the job a process is running: the solver and
+  // the input pickers poll the token between iterations, and throw cancelled
+  // once it is set, so that a worker can drop its job and take the next one.
+  // The token is set from a signal handler, hence the sig_atomic_t.
+  struct cancelled : std::exception {
+      const char* what () const noexcept override { return "job cancelled"; }
+  };
+
+  inline volatile std::sig_atomic_t cancel_requested = 0;
+
+  inline void request_cancel (int) { cancel_requested = 1; }
+
+  inline void reset_cancel () { cancel_requested = 0; }
+
+  // a channel on which any incoming data also cancels the job, for processes
+  // that cannot be signalled, such as remote workers; as this costs a system
+  // call, it is only looked at every so often
+  inline int cancel_fd = -1;
+
+  inline void check_cancelled () {
+    static unsigned calls = 0;
+    if (cancel_fd >= 0 and ++calls % 64 == 0) {
+      pollfd p {cancel_fd, POLLIN, 0};
+      if (poll (&p, 1, 0) > 0)
+        cancel_requested = 1;
+    }
+    if (cancel_requested)
+      throw cancelled ();
+  }
+
+  // cancel the running job when receiving sig
+  inline void cancel_on (int sig) {
+    struct sigaction action {};
+    action.sa_handler = request_cancel;
+    sigemptyset (&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction (sig, &action, nullptr);
+  }
+}
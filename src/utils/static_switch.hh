@@ -1,5 +1,8 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <functional>
 #include <type_traits>
 #include <utility>
 
@@ -37,3 +40,108 @@ struct static_switch_t {
       return table[i] (std::addressof (f), std::forward<Args> (args)...);
     }
 };
+
+// Tiers of values for static_tier_switch_t: only the values in [0, M] that are
+// tiers, and that the capacity function of the switch leaves as they are, get a
+// specialization, M always being one of them.
+namespace static_tiers {
+  // Every value is a tier: same as static_switch_t.
+  struct exact {
+      static constexpr bool is_tier (size_t) { return true; }
+  };
+
+  // Powers of two.
+  struct pow2 {
+      static constexpr bool is_tier (size_t i) { return i > 0 and (i & (i - 1)) == 0; }
+  };
+
+  // User-defined tiers, e.g., list<16, 32, 64, 128>, in increasing order;
+  // each of them must be a capacity, see static_tier_switch_t.
+  template<size_t... Tiers>
+  struct list {
+      static constexpr std::array<size_t, sizeof... (Tiers)> listed {Tiers...};
+      static_assert (std::is_sorted (listed.begin (), listed.end (), std::less_equal<> {}),
+                     "tiers must be listed in increasing order");
+
+      static constexpr bool is_tier (size_t i) { return ((i == Tiers) or ...); }
+  };
+
+  namespace detail {
+    struct identity {
+        constexpr size_t operator () (size_t i) const { return i; }
+    };
+
+    template<class Tiers, size_t M, class Capacity>
+    constexpr bool is_value (size_t i) {
+      return (i == M or Tiers::is_tier (i)) and Capacity {} (i) == i;
+    }
+
+    template<class Tiers, size_t M, class Capacity>
+    constexpr size_t count () {
+      size_t n = 0;
+      for (size_t i = 0; i <= M; ++i)
+        if (is_value<Tiers, M, Capacity> (i))
+          ++n;
+      return n;
+    }
+
+    template<class Tiers, size_t M, class Capacity>
+    constexpr auto values () {
+      std::array<size_t, count<Tiers, M, Capacity> ()> ret {};
+      size_t n = 0;
+      for (size_t i = 0; i <= M; ++i)
+        if (is_value<Tiers, M, Capacity> (i))
+          ret[n++] = i;
+      return ret;
+    }
+
+    // the tiers that were listed explicitly are all kept
+    template<class Tiers, size_t M, class Capacity>
+    constexpr bool listed_kept () {
+      if constexpr (requires { Tiers::listed; }) {
+        for (auto t : Tiers::listed)
+          if (t <= M and not is_value<Tiers, M, Capacity> (t))
+            return false;
+      }
+      return true;
+    }
+  }
+}
+
+// Same as static_switch_t, but f is called with the smallest tier that is at
+// least i, rather than with i itself.  This trades padding for fewer
+// instantiations of f.  When i is always a capacity, as rounded up by
+// Capacity, the values that are not are never reached and are no tiers; M and
+// the listed tiers must be capacities.
+template<class Tiers, size_t M, class Capacity = static_tiers::detail::identity>
+struct static_tier_switch_t {
+    static_assert (Capacity {} (M) == M, "the largest tier must be a capacity");
+    static_assert (static_tiers::detail::listed_kept<Tiers, M, Capacity> (),
+                   "every listed tier must be a capacity");
+
+    static constexpr auto tiers = static_tiers::detail::values<Tiers, M, Capacity> ();
+    static_assert (std::is_sorted (tiers.begin (), tiers.end (), std::less_equal<> {}));
+
+    static constexpr size_t tier_for (size_t i) {
+      for (auto t : tiers)
+        if (t >= i)
+          return t;
+      return M;
+    }
+
+    template<class F, class G, class...Args>
+    auto operator () (F&& f, G&& g, size_t i, Args&& ...args) const {
+      if (i > M)
+        return g (i, std::forward<Args> (args)...);
+
+      size_t tier = 0;
+      while (tiers[tier] < i)
+        ++tier;
+
+      return static_switch_t<tiers.size () - 1> {} (
+        [&f] (auto vtier, auto&& ...as) {
+          return f (index_t<tiers[vtier.value]> {}, std::forward<decltype (as)> (as)...);
+        },
+        std::forward<G> (g), tier, std::forward<Args> (args)...);
+    }
+};
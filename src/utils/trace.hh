@@ -0,0 +1,123 @@
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+
+#include "../error_msg.hh"
+
+namespace utils::trace {
+  // Timeline in the Chrome trace event format, to be opened offline in
+  // chrome://tracing or ui.perfetto.dev: each checking process is a process
+  // of the trace, and each composition worker a track in it, 0 being the
+  // coordinator.  All the processes append to the same file, one event per
+  // write, which O_APPEND keeps whole.  The array is closed by the process
+  // that opened the file; viewers also accept it unclosed, after a crash.
+  namespace detail {
+    inline int fd = -1;
+    inline pid_t owner = -1;
+    inline pid_t pid = 0;
+    inline int tid = 0;
+
+    inline long long now () {
+      using namespace std::chrono;
+      return duration_cast<microseconds> (steady_clock::now ().time_since_epoch ()).count ();
+    }
+
+    inline std::string quote (const std::string& s) {
+      std::string res = "\"";
+      for (char c : s) {
+        if (c == '"' or c == '\\')
+          res += '\\';
+        res += c;
+      }
+      return res + "\"";
+    }
+
+    inline void emit (const std::string& event, const char* sep = ",\n") {
+      std::string line = "{" + event + ",\"pid\":" + std::to_string (pid)
+        + ",\"tid\":" + std::to_string (tid) + "}" + sep;
+      [[maybe_unused]] auto written = ::write (fd, line.data (), line.size ());
+    }
+
+    inline void name (const char* what, const std::string& name, const char* sep = ",\n") {
+      emit (std::string ("\"name\":\"") + what + "\",\"ph\":\"M\",\"args\":{\"name\":"
+            + quote (name) + "}", sep);
+    }
+  }
+
+  inline bool enabled () { return detail::fd >= 0; }
+
+  inline void close () {
+    // the other processes inherit this at fork
+    if (not enabled () or getpid () != detail::owner)
+      return;
+    detail::tid = 0;
+    detail::name ("thread_name", "main", "]\n");
+    ::close (detail::fd);
+    detail::fd = -1;
+  }
+
+  inline void open (const std::string& fname) {
+    detail::fd = ::open (fname.c_str (), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (detail::fd < 0)
+      error (2, errno, "cannot open trace file %s", fname.c_str ());
+    detail::owner = detail::pid = getpid ();
+    [[maybe_unused]] auto written = ::write (detail::fd, "[\n", 2);
+    atexit (close);
+  }
+
+  // the events of this process go to a process of the trace called name
+  inline void set_process (const std::string& name) {
+    if (not enabled ())
+      return;
+    detail::pid = getpid ();
+    detail::tid = 0;
+    detail::name ("process_name", name);
+  }
+
+  // the events of this process go to the track id of its trace process
+  inline void set_track (int id, const std::string& name) {
+    if (not enabled ())
+      return;
+    detail::tid = id;
+    detail::name ("thread_name", name);
+  }
+
+  // an event from its construction to its end (), or its destruction,
+  // with numeric arguments such as sizes
+  class span {
+    public:
+      explicit span (const char* name) : name {name} {
+        if (enabled ())
+          start = detail::now ();
+      }
+
+      ~span () { end (); }
+
+      template <typename T>
+      span& arg (const char* key, T value) {
+        if (enabled ())
+          args += std::string (args.empty () ? "" : ",") + "\"" + key + "\":" + std::to_string (value);
+        return *this;
+      }
+
+      void end () {
+        if (not enabled () or done)
+          return;
+        done = true;
+        detail::emit (std::string ("\"name\":\"") + name + "\",\"ph\":\"X\",\"ts\":" + std::to_string (start)
+                      + ",\"dur\":" + std::to_string (detail::now () - start)
+                      + ",\"args\":{" + args + "}");
+      }
+
+    private:
+      const char* name;
+      long long start = 0;
+      bool done = false;
+      std::string args;
+  };
+}